@@ -0,0 +1,109 @@
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "./lib/simd.hpp"
+#include "./lib/vec_op.hpp"
+#include "./utils/err.hpp"
+
+// measure average time of a kernel in microseconds
+double time_kernel(std::function<void()> kernel, int repeats) {
+    kernel();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        kernel();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / repeats;
+}
+
+qs::c_vec random_vec(int dim, std::mt19937& rng) {
+    std::uniform_real_distribution<double> dist(-1, 1);
+    qs::c_vec v(dim);
+    for (qs::Complex& x : v) {
+        x = qs::Complex(dist(rng), dist(rng));
+    }
+    return v;
+}
+
+qs::c_mat random_mat(int dim, std::mt19937& rng) {
+    std::uniform_real_distribution<double> dist(-1, 1);
+    qs::c_mat m(dim);
+    for (qs::Complex& x : m.flat()) {
+        x = qs::Complex(dist(rng), dist(rng));
+    }
+    return m;
+}
+
+int main(int argc, char* argv[]) {
+    qs::check_err(argc % 2 == 0, "main", "Invalid number of arguments");
+
+    int n = 8;
+    int repeats = 10;
+
+    // parse command-line arguments
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--n") == 0) {
+            n = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repeats") == 0) {
+            repeats = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            qs::_set_matmul_threads(std::stoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--block") == 0) {
+            qs::_set_matmul_block(std::stoi(argv[++i]));
+        } else {
+            qs::check_err(true, "main", std::string("Invalid argument: ") + std::string(argv[i]));
+        }
+    }
+
+    // operands of the size of n-qubit operators
+    int dim = 1 << n;
+    std::mt19937 rng(42);
+    qs::c_vec a = random_vec(dim, rng);
+    qs::c_vec b = random_vec(dim, rng);
+    qs::c_mat m = random_mat(dim, rng);
+    qs::c_mat k = random_mat(dim, rng);
+    qs::c_vec small_v = random_vec(2, rng);
+    qs::c_mat small_m = random_mat(2, rng);
+
+    std::vector<std::pair<std::string, std::function<void()>>> kernels = {
+        {"_matvecmul", [&]() { qs::_matvecmul(m, a); }},
+        {"_vecmatmul", [&]() { qs::_vecmatmul(a, m); }},
+        {"_inner", [&]() { qs::_inner(a, b); }},
+        {"_outer", [&]() { qs::_outer(a, b); }},
+        {"_tensor [vector]", [&]() { qs::_tensor(a, small_v); }},
+        {"_tensor [matrix]", [&]() { qs::_tensor(m, small_m); }},
+        {"_matmul", [&]() { qs::_matmul(m, k); }},
+    };
+
+    std::vector<qs::SimdLevel> levels = {qs::SimdLevel::SCALAR};
+    if (qs::_simd_supported() != qs::SimdLevel::SCALAR) {
+        levels.push_back(qs::SimdLevel::AVX2);
+    }
+    if (qs::_simd_supported() == qs::SimdLevel::AVX512) {
+        levels.push_back(qs::SimdLevel::AVX512);
+    }
+
+    std::cout << "Kernels on " << n << " qubits (dimension " << dim << "), average of " << repeats << " runs [us]:" << std::endl;
+    for (std::pair<std::string, std::function<void()>>& kernel : kernels) {
+        std::cout << kernel.first << ":";
+        double scalar_time = 0;
+        for (qs::SimdLevel level : levels) {
+            qs::_set_simd_level(level);
+            double t = time_kernel(kernel.second, repeats);
+            if (level == qs::SimdLevel::SCALAR) {
+                scalar_time = t;
+            }
+            std::cout << " " << qs::_simd_name(level) << "=" << t;
+            if (level != qs::SimdLevel::SCALAR) {
+                std::cout << " (" << scalar_time / t << "x)";
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
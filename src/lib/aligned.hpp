@@ -0,0 +1,48 @@
+#ifndef __ALIGNED_HPP__
+#define __ALIGNED_HPP__
+
+#include <cstddef>
+#include <new>
+
+namespace qs {
+
+    // alignment of all numeric buffers, enough for a full AVX-512 register and a cache line
+    constexpr std::size_t buffer_alignment = 64;
+
+    // allocator for std::vector which places the buffer on an aligned address
+    // so that SIMD kernels can use aligned loads and rows never straddle cache lines unnecessarily
+    template <typename T>
+    class AlignedAllocator {
+    public:
+        typedef T value_type;
+
+        AlignedAllocator() noexcept {}
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U> &) noexcept {}
+
+        T *allocate(std::size_t n) {
+            return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(buffer_alignment)));
+        }
+
+        void deallocate(T *p, std::size_t) noexcept {
+            ::operator delete(p, std::align_val_t(buffer_alignment));
+        }
+
+        template <typename U>
+        struct rebind {
+            typedef AlignedAllocator<U> other;
+        };
+    };
+
+    template <typename T, typename U>
+    bool operator==(const AlignedAllocator<T> &, const AlignedAllocator<U> &) {
+        return true;
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const AlignedAllocator<T> &, const AlignedAllocator<U> &) {
+        return false;
+    }
+};
+
+#endif
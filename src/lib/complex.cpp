@@ -1,44 +1,45 @@
 #include "complex.hpp"
 
-qs::Complex qs::Complex::operator+(qs::Complex& other) {
+qs::Complex qs::Complex::operator+(const qs::Complex& other) const {
     return qs::Complex(this->Re + other.Re, this->Im + other.Im);
 }
 
-qs::Complex qs::Complex::operator-(qs::Complex& other) {
+qs::Complex qs::Complex::operator-(const qs::Complex& other) const {
     return qs::Complex(this->Re - other.Re, this->Im - other.Im);
 }
 
-qs::Complex qs::Complex::operator*(qs::Complex& other) {
+qs::Complex qs::Complex::operator*(const qs::Complex& other) const {
     return qs::Complex(this->Re * other.Re - this->Im * other.Im, this->Re * other.Im + this->Im * other.Re);
 }
 
-qs::Complex& qs::Complex::operator+=(qs::Complex& other) {
+qs::Complex& qs::Complex::operator+=(const qs::Complex& other) {
     this->Re += other.Re;
     this->Im += other.Im;
     return *this;
 }
 
-qs::Complex& qs::Complex::operator-=(qs::Complex& other) {
+qs::Complex& qs::Complex::operator-=(const qs::Complex& other) {
     this->Re -= other.Re;
     this->Im -= other.Im;
     return *this;
 }
 
-qs::Complex& qs::Complex::operator*=(qs::Complex& other) {
-    this->Re = this->Re * other.Re - this->Im * other.Im;
+qs::Complex& qs::Complex::operator*=(const qs::Complex& other) {
+    double re = this->Re * other.Re - this->Im * other.Im;
     this->Im = this->Re * other.Im + this->Im * other.Re;
+    this->Re = re;
     return *this;
 }
 
-qs::Complex qs::Complex::conjugate() {
+qs::Complex qs::Complex::conjugate() const {
     return qs::Complex(this->Re, -this->Im);
 }
 
-double qs::Complex::magnitude() {
+double qs::Complex::magnitude() const {
     return sqrt(this->Re * this->Re + this->Im * this->Im);
 }
 
-std::string qs::Complex::str() {
+std::string qs::Complex::str() const {
     std::stringstream ss;
     ss << this->Re;
     if (this->Im > 0) {
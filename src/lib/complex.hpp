@@ -1,6 +1,7 @@
 #ifndef __COMPLEX_HPP__
 #define __COMPLEX_HPP__
 
+#include <cmath>
 #include <iostream>
 #include <sstream>
 
@@ -17,22 +18,22 @@ namespace qs {
         Complex() : Re(0), Im(0) {}
 
         // override basic oparators needed in quantum circuits
-        Complex operator+(Complex& other);
-        Complex operator-(Complex& other);
-        Complex operator*(Complex& other);
-        Complex& operator+=(Complex& other);
-        Complex& operator-=(Complex& other);
-        Complex& operator*=(Complex& other);
+        Complex operator+(const Complex& other) const;
+        Complex operator-(const Complex& other) const;
+        Complex operator*(const Complex& other) const;
+        Complex& operator+=(const Complex& other);
+        Complex& operator-=(const Complex& other);
+        Complex& operator*=(const Complex& other);
 
         // create a complex conjugate of this complex number
         // z = Re + Im * i => z* = Re - Im * i
-        Complex conjugate();
+        Complex conjugate() const;
 
         // compute magnitude of this complex number
         // |z| = sqrt(Re^2 + Im^2)
-        double magnitude();
+        double magnitude() const;
 
-        std::string str();
+        std::string str() const;
     };
 };
 
@@ -0,0 +1,214 @@
+#include "./csr.hpp"
+
+#include <algorithm>
+
+static bool is_zero(const qs::Complex& x) {
+    return x.Re == 0 && x.Im == 0;
+}
+
+qs::c_csr qs::_to_csr(qs::c_mat& a) {
+    std::size_t dim = a.size();
+    qs::c_csr res(dim);
+    for (std::size_t r = 0; r < dim; ++r) {
+        for (std::size_t c = 0; c < dim; ++c) {
+            if (!is_zero(a[r][c])) {
+                res.cols.push_back(c);
+                res.values.push_back(a[r][c]);
+            }
+        }
+        res.row_ptr[r + 1] = res.values.size();
+    }
+    return res;
+}
+
+qs::c_mat qs::_to_dense(qs::c_csr& a) {
+    qs::c_mat res(a.size());
+    for (std::size_t r = 0; r < a.size(); ++r) {
+        for (std::size_t i = a.row_ptr[r]; i < a.row_ptr[r + 1]; ++i) {
+            res[r][a.cols[i]] = a.values[i];
+        }
+    }
+    return res;
+}
+
+std::size_t qs::_nnz(qs::c_mat& a) {
+    return std::count_if(a.flat().begin(), a.flat().end(), [](qs::Complex& x) { return !is_zero(x); });
+}
+
+// merge sorted rows of a and b scaled by sign, entries which cancel out are dropped
+static qs::c_csr merge(qs::c_csr& a, qs::c_csr& b, double sign) {
+    qs::check_dims("_add", a.size(), b.size());
+
+    qs::c_csr res(a.size());
+    qs::Complex scale(sign);
+    for (std::size_t r = 0; r < a.size(); ++r) {
+        std::size_t i = a.row_ptr[r];
+        std::size_t j = b.row_ptr[r];
+        while (i < a.row_ptr[r + 1] || j < b.row_ptr[r + 1]) {
+            std::size_t col;
+            qs::Complex x;
+            if (j == b.row_ptr[r + 1] || (i < a.row_ptr[r + 1] && a.cols[i] < b.cols[j])) {
+                col = a.cols[i];
+                x = a.values[i++];
+            } else if (i == a.row_ptr[r + 1] || b.cols[j] < a.cols[i]) {
+                col = b.cols[j];
+                x = scale * b.values[j++];
+            } else {
+                col = a.cols[i];
+                x = a.values[i++] + scale * b.values[j++];
+            }
+            if (!is_zero(x)) {
+                res.cols.push_back(col);
+                res.values.push_back(x);
+            }
+        }
+        res.row_ptr[r + 1] = res.values.size();
+    }
+    return res;
+}
+
+qs::c_csr qs::_add(qs::c_csr& a, qs::c_csr& b) {
+    return merge(a, b, 1);
+}
+
+qs::c_csr qs::_sub(qs::c_csr& a, qs::c_csr& b) {
+    return merge(a, b, -1);
+}
+
+qs::c_csr qs::_mul(qs::Complex& c, qs::c_csr& a) {
+    qs::c_csr res = a;
+    for (qs::Complex& x : res.values) {
+        x = c * x;
+    }
+    return res;
+}
+
+qs::c_csr qs::_transpose(qs::c_csr& a) {
+    std::size_t dim = a.size();
+    qs::c_csr res(dim);
+    res.cols.resize(a.nnz());
+    res.values.resize(a.nnz());
+
+    // count entries in every column and place them row by row, which keeps the columns of the result sorted
+    for (std::size_t col : a.cols) {
+        ++res.row_ptr[col + 1];
+    }
+    for (std::size_t r = 0; r < dim; ++r) {
+        res.row_ptr[r + 1] += res.row_ptr[r];
+    }
+    std::vector<std::size_t> next(res.row_ptr.begin(), res.row_ptr.end() - 1);
+    for (std::size_t r = 0; r < dim; ++r) {
+        for (std::size_t i = a.row_ptr[r]; i < a.row_ptr[r + 1]; ++i) {
+            std::size_t pos = next[a.cols[i]]++;
+            res.cols[pos] = r;
+            res.values[pos] = a.values[i];
+        }
+    }
+    return res;
+}
+
+qs::c_csr qs::_dagger(qs::c_csr& a) {
+    qs::c_csr res = qs::_transpose(a);
+    for (qs::Complex& x : res.values) {
+        x = x.conjugate();
+    }
+    return res;
+}
+
+qs::c_vec qs::_matvecmul(qs::c_csr& m, qs::c_vec& x) {
+    qs::check_dims("_matvecmul", m.size(), x.size());
+
+    qs::c_vec res(m.size());
+    for (std::size_t r = 0; r < m.size(); ++r) {
+        for (std::size_t i = m.row_ptr[r]; i < m.row_ptr[r + 1]; ++i) {
+            res[r] += m.values[i] * x[m.cols[i]];
+        }
+    }
+    return res;
+}
+
+qs::c_vec qs::_vecmatmul(qs::c_vec& x, qs::c_csr& m) {
+    qs::check_dims("_vecmatmul", m.size(), x.size());
+
+    qs::c_vec res(m.size());
+    for (std::size_t r = 0; r < m.size(); ++r) {
+        for (std::size_t i = m.row_ptr[r]; i < m.row_ptr[r + 1]; ++i) {
+            res[m.cols[i]] += x[r] * m.values[i];
+        }
+    }
+    return res;
+}
+
+qs::c_csr qs::_matmul(qs::c_csr& a, qs::c_csr& b) {
+    qs::check_dims("_matmul", a.size(), b.size());
+
+    std::size_t dim = a.size();
+    std::size_t chunk = qs::_chunk_size(dim, 64);
+    std::vector<qs::c_csr> partial((dim + chunk - 1) / chunk);
+
+    // row r of the result is a combination of rows of b, accumulated in a dense row and collected by its touched columns
+    qs::_parallel_for(dim, qs::_hardware_threads(), [&](std::size_t begin, std::size_t end) {
+        qs::c_csr& part = partial[begin / chunk];
+        part.row_ptr.assign(end - begin + 1, 0);
+        qs::c_vec row(dim);
+        std::vector<bool> touched(dim, false);
+        std::vector<std::size_t> cols;
+        for (std::size_t r = begin; r < end; ++r) {
+            cols.clear();
+            for (std::size_t i = a.row_ptr[r]; i < a.row_ptr[r + 1]; ++i) {
+                std::size_t k = a.cols[i];
+                for (std::size_t j = b.row_ptr[k]; j < b.row_ptr[k + 1]; ++j) {
+                    std::size_t c = b.cols[j];
+                    if (!touched[c]) {
+                        touched[c] = true;
+                        cols.push_back(c);
+                    }
+                    row[c] += a.values[i] * b.values[j];
+                }
+            }
+            std::sort(cols.begin(), cols.end());
+            for (std::size_t c : cols) {
+                if (!is_zero(row[c])) {
+                    part.cols.push_back(c);
+                    part.values.push_back(row[c]);
+                }
+                row[c] = qs::Complex();
+                touched[c] = false;
+            }
+            part.row_ptr[r - begin + 1] = part.values.size();
+        }
+    }, 64);
+
+    qs::c_csr res(dim);
+    std::size_t r = 0;
+    for (qs::c_csr& part : partial) {
+        std::size_t offset = res.values.size();
+        for (std::size_t i = 1; i < part.row_ptr.size(); ++i) {
+            res.row_ptr[++r] = offset + part.row_ptr[i];
+        }
+        res.cols.insert(res.cols.end(), part.cols.begin(), part.cols.end());
+        res.values.insert(res.values.end(), part.values.begin(), part.values.end());
+    }
+    return res;
+}
+
+qs::c_csr qs::_tensor(qs::c_csr& a, qs::c_csr& b) {
+    std::size_t dim_b = b.size();
+    qs::c_csr res(a.size() * dim_b);
+    res.cols.reserve(a.nnz() * b.nnz());
+    res.values.reserve(a.nnz() * b.nnz());
+
+    // every row of the result is a concatenation of scaled rows of b in the order of columns of a
+    for (std::size_t r1 = 0; r1 < a.size(); ++r1) {
+        for (std::size_t r2 = 0; r2 < dim_b; ++r2) {
+            for (std::size_t i = a.row_ptr[r1]; i < a.row_ptr[r1 + 1]; ++i) {
+                for (std::size_t j = b.row_ptr[r2]; j < b.row_ptr[r2 + 1]; ++j) {
+                    res.cols.push_back(a.cols[i] * dim_b + b.cols[j]);
+                    res.values.push_back(a.values[i] * b.values[j]);
+                }
+            }
+            res.row_ptr[r1 * dim_b + r2 + 1] = res.values.size();
+        }
+    }
+    return res;
+}
@@ -0,0 +1,56 @@
+#ifndef __CSR_HPP__
+#define __CSR_HPP__
+
+#include <cstddef>
+#include <vector>
+
+#include "../utils/err.hpp"
+#include "../utils/parallel.hpp"
+#include "./complex.hpp"
+#include "./vec_op.hpp"
+
+namespace qs {
+
+    // square complex matrix in compressed sparse row format
+    // nonzero entries of row r are values[row_ptr[r]], ..., values[row_ptr[r + 1] - 1] in columns cols[...] sorted increasingly
+    class c_csr {
+    public:
+        std::size_t dim;
+        std::vector<std::size_t> row_ptr;
+        std::vector<std::size_t> cols;
+        c_vec values;
+
+        c_csr() : c_csr(0){};
+        // zero matrix of dimension dim x dim
+        c_csr(std::size_t dim) : dim(dim), row_ptr(dim + 1, 0){};
+
+        std::size_t size() const { return this->dim; }
+        std::size_t nnz() const { return this->values.size(); }
+        // fraction of nonzero entries
+        double fill() const { return this->dim == 0 ? 0 : (double)this->nnz() / ((double)this->dim * this->dim); }
+    };
+
+    // convert between the dense and the sparse representation, only exact zeros are dropped
+    c_csr _to_csr(c_mat& a);
+    c_mat _to_dense(c_csr& a);
+    // count nonzero entries of a dense matrix
+    std::size_t _nnz(c_mat& a);
+
+    // basic operations on sparse matrices
+    c_csr _add(c_csr& a, c_csr& b);
+    c_csr _sub(c_csr& a, c_csr& b);
+    c_csr _mul(Complex& c, c_csr& a);
+    // compute transpose of a sparse matrix, and its transpose and conjugate
+    c_csr _transpose(c_csr& a);
+    c_csr _dagger(c_csr& a);
+
+    // compute Mx and x^TM in complex numbers
+    c_vec _matvecmul(c_csr& m, c_vec& x);
+    c_vec _vecmatmul(c_vec& x, c_csr& m);
+    // compute AB row by row, rows of the result are split among threads
+    c_csr _matmul(c_csr& a, c_csr& b);
+    // tensor product of two sparse matrices
+    c_csr _tensor(c_csr& a, c_csr& b);
+};
+
+#endif
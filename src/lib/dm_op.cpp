@@ -0,0 +1,133 @@
+#include "./dm_op.hpp"
+
+qs::c_vec qs::_density_matrix(qs::c_vec& state, int n_threads) {
+    std::size_t dim = state.size();
+    qs::c_vec rho(dim * dim);
+    qs::_parallel_for(dim, n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t r = begin; r < end; ++r) {
+            for (std::size_t c = 0; c < dim; ++c) {
+                rho[r * dim + c] = state[r] * state[c].conjugate();
+            }
+        }
+    }, 64);
+    return rho;
+}
+
+std::vector<double> qs::_dm_probabilities(qs::c_vec& rho, int n_qubits, std::vector<int>& bits) {
+    std::size_t dim = (std::size_t)1 << n_qubits;
+    qs::check_dims("_dm_probabilities", rho.size(), dim * dim);
+    for (int bit : bits) {
+        qs::check_err(bit >= n_qubits, "_dm_probabilities", "qubit out of range");
+    }
+
+    // the diagonal has only 2^n of the 4^n elements, so it is summed serially
+    int k = bits.size();
+    std::vector<double> probs((std::size_t)1 << k, 0.0);
+    for (std::size_t i = 0; i < dim; ++i) {
+        std::size_t local = 0;
+        for (int j = 0; j < k; ++j) {
+            local = (local << 1) | ((i >> bits[j]) & 1);
+        }
+        probs[local] += rho[i * dim + i].Re;
+    }
+    return probs;
+}
+
+qs::c_mat qs::_reduced_density_matrix(qs::c_vec& state, std::vector<int>& bits, int n_threads) {
+    int k = bits.size();
+    int local_dim = 1 << k;
+    std::size_t mask = 0;
+    std::vector<std::size_t> offsets(local_dim, 0);
+    for (int j = 0; j < k; ++j) {
+        mask |= (std::size_t)1 << bits[j];
+        for (int l = 0; l < local_dim; ++l) {
+            if ((l >> (k - 1 - j)) & 1) {
+                offsets[l] |= (std::size_t)1 << bits[j];
+            }
+        }
+    }
+
+    // every chunk sums its own matrix, the partial matrices are added in a fixed order
+    std::size_t n = state.size();
+    std::size_t chunk = qs::_chunk_size(n, 1 << 14);
+    std::vector<qs::c_mat> partial((n + chunk - 1) / chunk, qs::c_mat(local_dim));
+    qs::_parallel_for(n, n_threads, [&](std::size_t begin, std::size_t end) {
+        // real and imaginary parts are accumulated separately in the hot loop
+        std::vector<double> re(local_dim * local_dim, 0), im(local_dim * local_dim, 0);
+        for (std::size_t base = begin; base < end; ++base) {
+            if (base & mask) {
+                continue;
+            }
+            for (int r = 0; r < local_dim; ++r) {
+                const qs::Complex &a = state[base | offsets[r]];
+                for (int c = 0; c < local_dim; ++c) {
+                    const qs::Complex &b = state[base | offsets[c]];
+                    re[r * local_dim + c] += a.Re * b.Re + a.Im * b.Im;
+                    im[r * local_dim + c] += a.Im * b.Re - a.Re * b.Im;
+                }
+            }
+        }
+        qs::c_mat &rho = partial[begin / chunk];
+        for (int i = 0; i < local_dim * local_dim; ++i) {
+            rho[i / local_dim][i % local_dim] = qs::Complex(re[i], im[i]);
+        }
+    }, 1 << 14);
+
+    qs::c_mat rho(local_dim);
+    for (qs::c_mat &chunk_rho : partial) {
+        for (int r = 0; r < local_dim; ++r) {
+            for (int c = 0; c < local_dim; ++c) {
+                rho[r][c] += chunk_rho[r][c];
+            }
+        }
+    }
+    return rho;
+}
+
+double qs::_trace(qs::c_vec& rho, int n_qubits) {
+    std::size_t dim = (std::size_t)1 << n_qubits;
+    qs::check_dims("_trace", rho.size(), dim * dim);
+
+    double trace = 0;
+    for (std::size_t i = 0; i < dim; ++i) {
+        trace += rho[i * dim + i].Re;
+    }
+    return trace;
+}
+
+qs::c_vec qs::_dm_pauli_traces(qs::c_vec& rho, int n_qubits, std::size_t x_mask, std::vector<std::size_t>& z_masks) {
+    std::size_t dim = (std::size_t)1 << n_qubits;
+    qs::check_dims("_dm_pauli_traces", rho.size(), dim * dim);
+    qs::check_err(x_mask >= dim, "_dm_pauli_traces", "qubit out of range");
+
+    // X^x Z^z maps |j> to (-1)^(j & z) |j ^ x>, so the trace sums (-1)^(j & z) rho[j][j ^ x]
+    qs::c_vec values(z_masks.size());
+    for (std::size_t j = 0; j < dim; ++j) {
+        qs::Complex& x = rho[j * dim + (j ^ x_mask)];
+        for (std::size_t t = 0; t < z_masks.size(); ++t) {
+            if (__builtin_popcountll(j & z_masks[t]) & 1) {
+                values[t] -= x;
+            } else {
+                values[t] += x;
+            }
+        }
+    }
+    return values;
+}
+
+void qs::_apply_readout(std::vector<double>& probs, int bit, double p01, double p10) {
+    std::size_t stride = (std::size_t)1 << bit;
+    qs::check_err(stride >= probs.size(), "_apply_readout", "bit out of range");
+
+    // pairs of outcomes which differ only in the bit are mixed by the confusion matrix
+    for (std::size_t i0 = 0; i0 < probs.size(); ++i0) {
+        if (i0 & stride) {
+            continue;
+        }
+        std::size_t i1 = i0 | stride;
+        double a = probs[i0];
+        double b = probs[i1];
+        probs[i0] = (1 - p01) * a + p10 * b;
+        probs[i1] = p01 * a + (1 - p10) * b;
+    }
+}
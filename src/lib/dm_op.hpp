@@ -0,0 +1,40 @@
+#ifndef __DM_OP_HPP__
+#define __DM_OP_HPP__
+
+#include <cstddef>
+#include <vector>
+
+#include "../utils/err.hpp"
+#include "../utils/parallel.hpp"
+#include "./complex.hpp"
+#include "./vec_op.hpp"
+
+// operations on a density matrix of n qubits vectorized into 4^n amplitudes of 2n qubits
+// element rho[r][c] is stored at index (r << n) | c, so the row qubits are the most significant
+// a gate U is applied to the row qubits and conj(U) to the column qubits by the state vector kernels
+namespace qs {
+
+    // density matrix |psi><psi| of a pure state
+    c_vec _density_matrix(c_vec& state, int n_threads = 1);
+
+    // compute marginal probability distribution over the qubits at bit positions bits from the diagonal of rho
+    // bits[0] corresponds to the most significant bit of the index of the resulting distribution
+    std::vector<double> _dm_probabilities(c_vec& rho, int n_qubits, std::vector<int>& bits);
+
+    // reduced density matrix of a pure state on the qubits at bit positions bits, the other qubits are traced out
+    // bits[0] corresponds to the most significant bit of the row and column index
+    c_mat _reduced_density_matrix(c_vec& state, std::vector<int>& bits, int n_threads = 1);
+
+    // compute Tr(X^x Z^z rho) for every z in z_masks, where X^x flips the bits of x_mask
+    // and Z^z negates the basis states whose bits of z have odd parity
+    // only the 2^n elements rho[j][j ^ x] contribute
+    c_vec _dm_pauli_traces(c_vec& rho, int n_qubits, std::size_t x_mask, std::vector<std::size_t>& z_masks);
+
+    // compute trace of the density matrix
+    double _trace(c_vec& rho, int n_qubits);
+
+    // misread bit at position bit of the outcomes of the distribution, 0 is read as 1 with probability p01 and 1 as 0 with p10
+    void _apply_readout(std::vector<double>& probs, int bit, double p01, double p10);
+};
+
+#endif
@@ -37,11 +37,12 @@ void qs::_row_echelon(qs::b_mat& mat, int m, int n) {
         } else {
             // swap rows h and i_max
             std::swap(mat[h], mat[i_max]);
+            // eliminate in GF(2), i.e. add the pivot row to every row below with 1 in the pivot column
             for (int i = h + 1; i < m; ++i) {
-                int f = mat[i][k] / mat[h][k];
-                mat[i][k] = 0;
-                for (int j = k + 1; j < m + n; ++j) {
-                    mat[i][j] -= f * mat[h][j];
+                if (mat[i][k] == 1) {
+                    for (int j = k; j < m + n; ++j) {
+                        mat[i][j] ^= mat[h][j];
+                    }
                 }
             }
             ++k;
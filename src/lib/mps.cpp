@@ -0,0 +1,408 @@
+#include "./mps.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// multiply m x k matrix a by k x n matrix b, both stored row by row
+static qs::c_vec multiply(qs::c_vec& a, qs::c_vec& b, int m, int k, int n) {
+    qs::c_vec c(m * n);
+    for (int r = 0; r < m; ++r) {
+        for (int i = 0; i < k; ++i) {
+            qs::Complex x = a[r * k + i];
+            if (x.Re == 0 && x.Im == 0) {
+                continue;
+            }
+            for (int col = 0; col < n; ++col) {
+                c[r * n + col] += x * b[i * n + col];
+            }
+        }
+    }
+    return c;
+}
+
+// number of singular values kept, values negligible compared to the largest one are always dropped
+static int kept_values(std::vector<double>& s, int max_bond, double cutoff, double& total, double& kept) {
+    total = 0;
+    for (double value : s) {
+        total += value * value;
+    }
+
+    int r = 0;
+    kept = 0;
+    while (r < s.size() && r < max_bond && s[r] > 1e-14 * s[0] && s[r] * s[r] > cutoff * total) {
+        kept += s[r] * s[r];
+        ++r;
+    }
+    return std::max(r, 1);
+}
+
+qs::Mps::Mps(int n, int max_bond, double cutoff) {
+    qs::check_err(n < 1, "Mps", "at least one qubit is required");
+    qs::check_err(max_bond < 1, "Mps", "bond dimension must be positive");
+    qs::check_err(cutoff < 0, "Mps", "negative truncation threshold");
+
+    this->n = n;
+    this->max_bond = max_bond;
+    this->cutoff = cutoff;
+    this->bonds = std::vector<int>(n + 1, 1);
+    this->sites = std::vector<qs::c_vec>(n, qs::c_vec(2));
+    for (qs::c_vec& site : this->sites) {
+        site[0] = qs::Complex(1);
+    }
+    this->center = 0;
+    this->fidelity = 1;
+}
+
+int qs::Mps::size() {
+    return this->n;
+}
+
+void qs::Mps::set_qubit(int q, qs::Complex a0, qs::Complex a1) {
+    qs::check_range("Mps::set_qubit", q, this->n);
+    qs::check_err(this->bonds[q] != 1 || this->bonds[q + 1] != 1, "Mps::set_qubit", "qubit is entangled");
+
+    double norm = sqrt(a0.Re * a0.Re + a0.Im * a0.Im + a1.Re * a1.Re + a1.Im * a1.Im);
+    qs::check_err(norm == 0, "Mps::set_qubit", "zero state");
+    this->sites[q][0] = a0 * qs::Complex(1 / norm);
+    this->sites[q][1] = a1 * qs::Complex(1 / norm);
+}
+
+void qs::Mps::move_center(int site) {
+    // moving right: A[c] = U (S Vh), S Vh is absorbed into the next site
+    while (this->center < site) {
+        int c = this->center;
+        int bl = this->bonds[c];
+        int br = this->bonds[c + 1];
+        int bn = this->bonds[c + 2];
+
+        qs::c_vec u, vh;
+        std::vector<double> s;
+        qs::_svd(this->sites[c], bl * 2, br, u, s, vh);
+
+        double total, kept;
+        int r = kept_values(s, br, 0, total, kept);
+        int full = s.size();
+
+        qs::c_vec left(bl * 2 * r);
+        qs::c_vec rest(r * br);
+        for (int i = 0; i < bl * 2; ++i) {
+            for (int k = 0; k < r; ++k) {
+                left[i * r + k] = u[i * full + k];
+            }
+        }
+        for (int k = 0; k < r; ++k) {
+            for (int j = 0; j < br; ++j) {
+                rest[k * br + j] = vh[k * br + j] * qs::Complex(s[k]);
+            }
+        }
+
+        this->sites[c] = left;
+        this->sites[c + 1] = multiply(rest, this->sites[c + 1], r, br, 2 * bn);
+        this->bonds[c + 1] = r;
+        ++this->center;
+    }
+
+    // moving left: A[c] = (U S) Vh, U S is absorbed into the previous site
+    while (this->center > site) {
+        int c = this->center;
+        int bp = this->bonds[c - 1];
+        int bl = this->bonds[c];
+        int br = this->bonds[c + 1];
+
+        qs::c_vec u, vh;
+        std::vector<double> s;
+        qs::_svd(this->sites[c], bl, 2 * br, u, s, vh);
+
+        double total, kept;
+        int r = kept_values(s, bl, 0, total, kept);
+        int full = s.size();
+
+        qs::c_vec rest(bl * r);
+        qs::c_vec right(r * 2 * br);
+        for (int i = 0; i < bl; ++i) {
+            for (int k = 0; k < r; ++k) {
+                rest[i * r + k] = u[i * full + k] * qs::Complex(s[k]);
+            }
+        }
+        for (int k = 0; k < r; ++k) {
+            for (int j = 0; j < 2 * br; ++j) {
+                right[k * 2 * br + j] = vh[k * 2 * br + j];
+            }
+        }
+
+        this->sites[c] = right;
+        this->sites[c - 1] = multiply(this->sites[c - 1], rest, bp * 2, bl, r);
+        this->bonds[c] = r;
+        --this->center;
+    }
+}
+
+void qs::Mps::apply_block(qs::c_mat& m, int site, int k) {
+    int local_dim = 1 << k;
+    qs::check_dims("Mps::apply", m.size(), local_dim);
+
+    this->move_center(site);
+
+    // contract the sites into theta of shape (bl, 2^k, br)
+    int bl = this->bonds[site];
+    qs::c_vec theta = this->sites[site];
+    int width = 2;
+    for (int i = 1; i < k; ++i) {
+        int b = this->bonds[site + i];
+        int bn = this->bonds[site + i + 1];
+        theta = multiply(theta, this->sites[site + i], bl * width, b, 2 * bn);
+        width *= 2;
+    }
+    int br = this->bonds[site + k];
+
+    // apply the matrix to the physical index
+    qs::c_vec applied(bl * local_dim * br);
+    for (int l = 0; l < bl; ++l) {
+        for (int row = 0; row < local_dim; ++row) {
+            qs::Complex* out = &applied[(l * local_dim + row) * br];
+            for (int col = 0; col < local_dim; ++col) {
+                qs::Complex x = m[row][col];
+                if (x.Re == 0 && x.Im == 0) {
+                    continue;
+                }
+                qs::Complex* in = &theta[(l * local_dim + col) * br];
+                for (int r = 0; r < br; ++r) {
+                    out[r] += x * in[r];
+                }
+            }
+        }
+    }
+
+    // split theta back site by site from the left, the center ends at the last site of the block
+    int left_dim = bl;
+    int rest_width = local_dim;
+    qs::c_vec rest = applied;
+    for (int i = 0; i < k - 1; ++i) {
+        rest_width /= 2;
+        int rows = left_dim * 2;
+        int cols = rest_width * br;
+
+        qs::c_vec u, vh;
+        std::vector<double> s;
+        qs::_svd(rest, rows, cols, u, s, vh);
+
+        double total, kept;
+        int r = kept_values(s, this->max_bond, this->cutoff, total, kept);
+        int full = s.size();
+
+        // the discarded weight is removed and the kept singular values are scaled to preserve the norm
+        if (total > 0) {
+            this->fidelity *= kept / total;
+        }
+        double scale = kept > 0 ? sqrt(total / kept) : 1;
+
+        qs::c_vec a(rows * r);
+        qs::c_vec next(r * cols);
+        for (int row = 0; row < rows; ++row) {
+            for (int j = 0; j < r; ++j) {
+                a[row * r + j] = u[row * full + j];
+            }
+        }
+        for (int j = 0; j < r; ++j) {
+            for (int col = 0; col < cols; ++col) {
+                next[j * cols + col] = vh[j * cols + col] * qs::Complex(s[j] * scale);
+            }
+        }
+
+        this->sites[site + i] = a;
+        this->bonds[site + i + 1] = r;
+        rest = next;
+        left_dim = r;
+    }
+    this->sites[site + k - 1] = rest;
+    this->center = site + k - 1;
+}
+
+void qs::Mps::apply(qs::c_mat& m, std::vector<int>& qubits) {
+    int k = qubits.size();
+    qs::check_err(k == 0, "Mps::apply", "no qubits");
+    qs::check_dims("Mps::apply", m.size(), 1 << k);
+    for (int i = 0; i < k; ++i) {
+        qs::check_range("Mps::apply", qubits[i], this->n);
+        qs::check_err(i > 0 && qubits[i] <= qubits[i - 1], "Mps::apply", "qubits are not sorted");
+    }
+
+    // single-qubit matrix acts on the physical index only and keeps the canonical form
+    if (k == 1) {
+        int q = qubits[0];
+        int bl = this->bonds[q];
+        int br = this->bonds[q + 1];
+        qs::c_vec& a = this->sites[q];
+        for (int l = 0; l < bl; ++l) {
+            for (int r = 0; r < br; ++r) {
+                qs::Complex x0 = a[(l * 2) * br + r];
+                qs::Complex x1 = a[(l * 2 + 1) * br + r];
+                a[(l * 2) * br + r] = m[0][0] * x0 + m[0][1] * x1;
+                a[(l * 2 + 1) * br + r] = m[1][0] * x0 + m[1][1] * x1;
+            }
+        }
+        return;
+    }
+
+    qs::c_mat swap{{qs::Complex(1), qs::Complex(0), qs::Complex(0), qs::Complex(0)},
+                   {qs::Complex(0), qs::Complex(0), qs::Complex(1), qs::Complex(0)},
+                   {qs::Complex(0), qs::Complex(1), qs::Complex(0), qs::Complex(0)},
+                   {qs::Complex(0), qs::Complex(0), qs::Complex(0), qs::Complex(1)}};
+
+    // move every qubit next to the previous one, the qubits in between shift to the right
+    std::vector<int> swaps;
+    for (int i = 1; i < k; ++i) {
+        for (int site = qubits[i]; site > qubits[0] + i; --site) {
+            this->apply_block(swap, site - 1, 2);
+            swaps.push_back(site - 1);
+        }
+    }
+
+    this->apply_block(m, qubits[0], k);
+
+    for (int i = swaps.size() - 1; i >= 0; --i) {
+        this->apply_block(swap, swaps[i], 2);
+    }
+}
+
+double qs::Mps::truncation_error() {
+    return std::max(1 - this->fidelity, 0.0);
+}
+
+std::vector<int> qs::Mps::bond_dimensions() {
+    return this->bonds;
+}
+
+void qs::Mps::canonicalize() {
+    this->move_center(0);
+}
+
+std::vector<int> qs::Mps::sample(int last, std::mt19937& rng) {
+    qs::check_err(last >= this->n, "Mps::sample", "site out of range");
+    qs::check_err(this->center != 0, "Mps::sample", "state is not in right-canonical form");
+
+    // in right-canonical form the weight of outcome s is the squared norm of v A_s
+    std::vector<int> outcomes(last + 1);
+    qs::c_vec v(1, qs::Complex(1));
+    std::uniform_real_distribution<double> dist(0, 1);
+    for (int q = 0; q <= last; ++q) {
+        int bl = this->bonds[q];
+        int br = this->bonds[q + 1];
+        qs::c_vec& a = this->sites[q];
+
+        qs::c_vec next[2] = {qs::c_vec(br), qs::c_vec(br)};
+        double probs[2] = {0, 0};
+        for (int s = 0; s < 2; ++s) {
+            for (int l = 0; l < bl; ++l) {
+                for (int r = 0; r < br; ++r) {
+                    next[s][r] += v[l] * a[(l * 2 + s) * br + r];
+                }
+            }
+            for (qs::Complex& x : next[s]) {
+                probs[s] += x.Re * x.Re + x.Im * x.Im;
+            }
+        }
+
+        int s = dist(rng) * (probs[0] + probs[1]) < probs[0] ? 0 : 1;
+        outcomes[q] = s;
+        v = next[s];
+        for (qs::Complex& x : v) {
+            x = x * qs::Complex(1 / sqrt(probs[s]));
+        }
+    }
+
+    return outcomes;
+}
+
+double qs::Mps::probability(std::vector<int>& outcomes) {
+    qs::check_err(outcomes.size() > this->n, "Mps::probability", "too many outcomes");
+    qs::check_err(this->center != 0, "Mps::probability", "state is not in right-canonical form");
+
+    // environment is a vector v as long as all sites are fixed, i.e. rho = v^H v
+    int q = 0;
+    double p = 1;
+    qs::c_vec v(1, qs::Complex(1));
+    for (; q < outcomes.size() && outcomes[q] != -1; ++q) {
+        int bl = this->bonds[q];
+        int br = this->bonds[q + 1];
+        qs::c_vec& a = this->sites[q];
+
+        qs::c_vec next(br);
+        for (int l = 0; l < bl; ++l) {
+            for (int r = 0; r < br; ++r) {
+                next[r] += v[l] * a[(l * 2 + outcomes[q]) * br + r];
+            }
+        }
+        double norm = 0;
+        for (qs::Complex& x : next) {
+            norm += x.Re * x.Re + x.Im * x.Im;
+        }
+        if (norm == 0) {
+            return 0;
+        }
+        p *= norm;
+        v = next;
+        for (qs::Complex& x : v) {
+            x = x * qs::Complex(1 / sqrt(norm));
+        }
+    }
+
+    // traced out sites turn the environment into a matrix rho, next rho = sum over s of A_s^H rho A_s
+    int dim = v.size();
+    qs::c_vec rho(dim * dim);
+    for (int i = 0; i < dim; ++i) {
+        for (int j = 0; j < dim; ++j) {
+            qs::Complex x = v[i];
+            x.Im = -x.Im;
+            rho[i * dim + j] = x * v[j];
+        }
+    }
+    for (; q < outcomes.size(); ++q) {
+        int bl = this->bonds[q];
+        int br = this->bonds[q + 1];
+        qs::c_vec& a = this->sites[q];
+
+        qs::c_vec next(br * br);
+        for (int s = 0; s < 2; ++s) {
+            if (outcomes[q] != -1 && outcomes[q] != s) {
+                continue;
+            }
+            // rho A_s
+            qs::c_vec tmp(bl * br);
+            for (int i = 0; i < bl; ++i) {
+                for (int l = 0; l < bl; ++l) {
+                    qs::Complex x = rho[i * bl + l];
+                    for (int r = 0; r < br; ++r) {
+                        tmp[i * br + r] += x * a[(l * 2 + s) * br + r];
+                    }
+                }
+            }
+            // A_s^H rho A_s
+            for (int i = 0; i < bl; ++i) {
+                for (int r1 = 0; r1 < br; ++r1) {
+                    qs::Complex x = a[(i * 2 + s) * br + r1];
+                    x.Im = -x.Im;
+                    for (int r2 = 0; r2 < br; ++r2) {
+                        next[r1 * br + r2] += x * tmp[i * br + r2];
+                    }
+                }
+            }
+        }
+
+        // keep rho at unit trace for numerical stability
+        double trace = 0;
+        for (int r = 0; r < br; ++r) {
+            trace += next[r * br + r].Re;
+        }
+        if (trace <= 0) {
+            return 0;
+        }
+        p *= trace;
+        rho = next;
+        for (qs::Complex& x : rho) {
+            x = x * qs::Complex(1 / trace);
+        }
+    }
+
+    return p;
+}
@@ -0,0 +1,59 @@
+#ifndef __MPS_HPP__
+#define __MPS_HPP__
+
+#include <random>
+#include <vector>
+
+#include "../utils/err.hpp"
+#include "./complex.hpp"
+#include "./svd.hpp"
+#include "./vec_op.hpp"
+
+namespace qs {
+
+    // matrix product state of n qubits, site q holds tensor A[q] of shape (left bond, 2, right bond) stored as [l][s][r]
+    // the state is kept in mixed canonical form around the center site, which allows optimal truncation
+    class Mps {
+    private:
+        int n;
+        int max_bond;
+        double cutoff;
+        std::vector<c_vec> sites;
+        // bonds[q] is the dimension of the bond between sites q - 1 and q, bonds[0] = bonds[n] = 1
+        std::vector<int> bonds;
+        // sites left of the center are left-orthonormal and sites right of it are right-orthonormal
+        int center;
+        // product of weights kept by all truncations
+        double fidelity;
+
+        void move_center(int site);
+        // apply 2^k x 2^k matrix to k consecutive sites starting at site and split them back by truncated svd
+        void apply_block(c_mat& m, int site, int k);
+
+    public:
+        // product state |0...0> whose bonds are truncated to max_bond and singular values with relative weight below cutoff
+        Mps(int n, int max_bond, double cutoff);
+
+        int size();
+
+        // set site q of a product state to a0 |0> + a1 |1>
+        void set_qubit(int q, Complex a0, Complex a1);
+
+        // apply 2^k x 2^k matrix to the sorted qubits, the first one corresponds to the most significant bit of the matrix index
+        // distant qubits are brought next to each other by swaps and returned back afterwards
+        void apply(c_mat& m, std::vector<int>& qubits);
+
+        // weight of the state discarded by all truncations so far
+        double truncation_error();
+        std::vector<int> bond_dimensions();
+
+        // bring the state to right-canonical form, which is required by sample
+        void canonicalize();
+        // draw outcomes of sites 0, ..., last from left to right carrying the left environment vector
+        std::vector<int> sample(int last, std::mt19937& rng);
+        // probability of outcomes of sites 0, ..., outcomes.size() - 1, the sites with outcome -1 are traced out
+        double probability(std::vector<int>& outcomes);
+    };
+};
+
+#endif
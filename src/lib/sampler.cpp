@@ -0,0 +1,118 @@
+#include "sampler.hpp"
+
+#include <algorithm>
+
+qs::Sampler::Sampler(std::vector<double> &weights) {
+    qs::check_err(weights.empty(), "Sampler", "empty distribution");
+
+    this->k = weights.size();
+    this->dist = std::uniform_real_distribution<double>(0, 1);
+
+    double total = 0.0;
+    for (double w : weights) {
+        qs::check_err(w < 0, "Sampler", "negative probability");
+        total += w;
+    }
+    qs::check_err(total <= 0, "Sampler", "distribution sums to zero");
+
+    // normalize and accumulate the distribution
+    this->probs.resize(this->k);
+    this->cumulative.resize(this->k);
+    double cum = 0.0;
+    for (int i = 0; i < this->k; ++i) {
+        this->probs[i] = weights[i] / total;
+        cum += this->probs[i];
+        this->cumulative[i] = cum;
+    }
+    this->cumulative[this->k - 1] = 1.0;
+
+    // build alias table by Vose's method, splitting indices to under-full and over-full buckets
+    this->alias_probs.resize(this->k);
+    this->aliases.resize(this->k);
+    std::vector<double> scaled(this->k);
+    std::vector<int> small;
+    std::vector<int> large;
+    for (int i = 0; i < this->k; ++i) {
+        scaled[i] = this->probs[i] * this->k;
+        if (scaled[i] < 1.0) {
+            small.push_back(i);
+        } else {
+            large.push_back(i);
+        }
+    }
+    while (!small.empty() && !large.empty()) {
+        int s = small.back();
+        small.pop_back();
+        int l = large.back();
+        this->alias_probs[s] = scaled[s];
+        this->aliases[s] = l;
+        // move the missing mass of the small bucket from the large one
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // remaining buckets are full up to rounding errors
+    for (int i : large) {
+        this->alias_probs[i] = 1.0;
+        this->aliases[i] = i;
+    }
+    for (int i : small) {
+        this->alias_probs[i] = 1.0;
+        this->aliases[i] = i;
+    }
+}
+
+int qs::Sampler::sample_alias(std::mt19937 &rng) {
+    double x = this->dist(rng) * this->k;
+    int i = std::min((int)x, this->k - 1);
+    return (x - i < this->alias_probs[i]) ? i : this->aliases[i];
+}
+
+int qs::Sampler::sample_cumulative(std::mt19937 &rng) {
+    double u = this->dist(rng);
+    int i = std::upper_bound(this->cumulative.begin(), this->cumulative.end(), u) - this->cumulative.begin();
+    return std::min(i, this->k - 1);
+}
+
+std::vector<int> qs::Sampler::sample_multinomial(int shots, std::mt19937 &rng) {
+    std::vector<int> counts(this->k, 0);
+
+    // draw every count from a binomial distribution conditioned on the counts drawn so far
+    int remaining = shots;
+    double remaining_p = 1.0;
+    for (int i = 0; i < this->k && remaining > 0; ++i) {
+        if (i == this->k - 1 || this->probs[i] >= remaining_p) {
+            counts[i] = remaining;
+            break;
+        }
+        std::binomial_distribution<int> binomial(remaining, this->probs[i] / remaining_p);
+        counts[i] = binomial(rng);
+        remaining -= counts[i];
+        remaining_p -= this->probs[i];
+    }
+    return counts;
+}
+
+std::vector<int> qs::Sampler::sample(int shots, std::mt19937 &rng, qs::SamplingMethod method) {
+    if (method == qs::SamplingMethod::AUTOMATIC) {
+        method = shots >= qs::Sampler::multinomial_shots ? qs::SamplingMethod::MULTINOMIAL : qs::SamplingMethod::ALIAS;
+    }
+
+    if (method == qs::SamplingMethod::MULTINOMIAL) {
+        return this->sample_multinomial(shots, rng);
+    }
+
+    std::vector<int> counts(this->k, 0);
+    if (method == qs::SamplingMethod::ALIAS) {
+        for (int i = 0; i < shots; ++i) {
+            ++counts[this->sample_alias(rng)];
+        }
+    } else {
+        for (int i = 0; i < shots; ++i) {
+            ++counts[this->sample_cumulative(rng)];
+        }
+    }
+    return counts;
+}
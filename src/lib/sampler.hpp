@@ -0,0 +1,54 @@
+#ifndef __SAMPLER_HPP__
+#define __SAMPLER_HPP__
+
+#include <random>
+#include <vector>
+
+#include "../utils/err.hpp"
+
+namespace qs {
+
+    // method used to draw shots from a discrete probability distribution
+    enum SamplingMethod : char {
+        // choose multinomial for large number of shots and alias table otherwise
+        AUTOMATIC = 'a',
+        // Walker alias table, O(1) per shot
+        ALIAS = 'w',
+        // binary search in cumulative distribution, O(log k) per shot
+        CUMULATIVE = 'c',
+        // draw counts of all outcomes at once by a sequence of binomial draws, O(k) in total
+        MULTINOMIAL = 'm',
+    };
+
+    // draws indices 0, ..., k - 1 from a discrete distribution
+    // all lookup tables are built once in the constructor
+    class Sampler {
+    private:
+        int k;
+        // normalized probabilities
+        std::vector<double> probs;
+        // cumulative distribution
+        std::vector<double> cumulative;
+        // alias table, index i is kept with probability alias_probs[i] and replaced by aliases[i] otherwise
+        std::vector<double> alias_probs;
+        std::vector<int> aliases;
+
+        std::uniform_real_distribution<double> dist;
+
+    public:
+        // number of shots from which the automatic method draws multinomial counts
+        static constexpr int multinomial_shots = 1000000;
+
+        Sampler(std::vector<double> &weights);
+
+        // draw a single index
+        int sample_alias(std::mt19937 &rng);
+        int sample_cumulative(std::mt19937 &rng);
+
+        // draw counts of all indices for the given number of shots
+        std::vector<int> sample_multinomial(int shots, std::mt19937 &rng);
+        std::vector<int> sample(int shots, std::mt19937 &rng, SamplingMethod method = SamplingMethod::AUTOMATIC);
+    };
+};
+
+#endif
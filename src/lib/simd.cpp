@@ -0,0 +1,239 @@
+#include "simd.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define QS_X86
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(qs::Complex) == 2 * sizeof(double), "Complex must be a pair of doubles");
+
+// scalar fallback
+
+static void caxpy_scalar(std::size_t n, double ar, double ai, const double* x, double* y) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double xr = x[2 * i];
+        double xi = x[2 * i + 1];
+        y[2 * i] += ar * xr - ai * xi;
+        y[2 * i + 1] += ar * xi + ai * xr;
+    }
+}
+
+static void cscale_scalar(std::size_t n, double ar, double ai, const double* x, double* y) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double xr = x[2 * i];
+        double xi = x[2 * i + 1];
+        y[2 * i] = ar * xr - ai * xi;
+        y[2 * i + 1] = ar * xi + ai * xr;
+    }
+}
+
+static void cdot_scalar(std::size_t n, const double* a, const double* b, double& re, double& im) {
+    for (std::size_t i = 0; i < n; ++i) {
+        re += a[2 * i] * b[2 * i] - a[2 * i + 1] * b[2 * i + 1];
+        im += a[2 * i] * b[2 * i + 1] + a[2 * i + 1] * b[2 * i];
+    }
+}
+
+#ifdef QS_X86
+
+// AVX2 kernels process 2 complex numbers per register
+// the product (ar + ai i)(xr + xi i) is computed as fmaddsub(ar, [xr, xi], ai * [xi, xr])
+
+__attribute__((target("avx2,fma"))) static void caxpy_avx2(std::size_t n, double ar, double ai, const double* x, double* y) {
+    __m256d vr = _mm256_set1_pd(ar);
+    __m256d vi = _mm256_set1_pd(ai);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m256d vx = _mm256_loadu_pd(x + 2 * i);
+        __m256d vy = _mm256_loadu_pd(y + 2 * i);
+        __m256d swapped = _mm256_permute_pd(vx, 0x5);
+        __m256d prod = _mm256_fmaddsub_pd(vr, vx, _mm256_mul_pd(vi, swapped));
+        _mm256_storeu_pd(y + 2 * i, _mm256_add_pd(vy, prod));
+    }
+    caxpy_scalar(n - i, ar, ai, x + 2 * i, y + 2 * i);
+}
+
+__attribute__((target("avx2,fma"))) static void cscale_avx2(std::size_t n, double ar, double ai, const double* x, double* y) {
+    __m256d vr = _mm256_set1_pd(ar);
+    __m256d vi = _mm256_set1_pd(ai);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m256d vx = _mm256_loadu_pd(x + 2 * i);
+        __m256d swapped = _mm256_permute_pd(vx, 0x5);
+        _mm256_storeu_pd(y + 2 * i, _mm256_fmaddsub_pd(vr, vx, _mm256_mul_pd(vi, swapped)));
+    }
+    cscale_scalar(n - i, ar, ai, x + 2 * i, y + 2 * i);
+}
+
+__attribute__((target("avx2,fma"))) static void cdot_avx2(std::size_t n, const double* a, const double* b, double& re, double& im) {
+    // accumulate [ar * br, ar * bi] and [ai * bi, ai * br] separately and combine them at the end
+    __m256d acc_r = _mm256_setzero_pd();
+    __m256d acc_i = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m256d va = _mm256_loadu_pd(a + 2 * i);
+        __m256d vb = _mm256_loadu_pd(b + 2 * i);
+        __m256d a_re = _mm256_movedup_pd(va);
+        __m256d a_im = _mm256_permute_pd(va, 0xf);
+        acc_r = _mm256_fmadd_pd(a_re, vb, acc_r);
+        acc_i = _mm256_fmadd_pd(a_im, _mm256_permute_pd(vb, 0x5), acc_i);
+    }
+    alignas(32) double r[4];
+    alignas(32) double s[4];
+    _mm256_store_pd(r, acc_r);
+    _mm256_store_pd(s, acc_i);
+    re += (r[0] + r[2]) - (s[0] + s[2]);
+    im += (r[1] + r[3]) + (s[1] + s[3]);
+    cdot_scalar(n - i, a + 2 * i, b + 2 * i, re, im);
+}
+
+// AVX-512 kernels process 4 complex numbers per register
+
+__attribute__((target("avx512f"))) static void caxpy_avx512(std::size_t n, double ar, double ai, const double* x, double* y) {
+    __m512d vr = _mm512_set1_pd(ar);
+    __m512d vi = _mm512_set1_pd(ai);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m512d vx = _mm512_loadu_pd(x + 2 * i);
+        __m512d vy = _mm512_loadu_pd(y + 2 * i);
+        __m512d swapped = _mm512_permute_pd(vx, 0x55);
+        __m512d prod = _mm512_fmaddsub_pd(vr, vx, _mm512_mul_pd(vi, swapped));
+        _mm512_storeu_pd(y + 2 * i, _mm512_add_pd(vy, prod));
+    }
+    caxpy_scalar(n - i, ar, ai, x + 2 * i, y + 2 * i);
+}
+
+__attribute__((target("avx512f"))) static void cscale_avx512(std::size_t n, double ar, double ai, const double* x, double* y) {
+    __m512d vr = _mm512_set1_pd(ar);
+    __m512d vi = _mm512_set1_pd(ai);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m512d vx = _mm512_loadu_pd(x + 2 * i);
+        __m512d swapped = _mm512_permute_pd(vx, 0x55);
+        _mm512_storeu_pd(y + 2 * i, _mm512_fmaddsub_pd(vr, vx, _mm512_mul_pd(vi, swapped)));
+    }
+    cscale_scalar(n - i, ar, ai, x + 2 * i, y + 2 * i);
+}
+
+__attribute__((target("avx512f"))) static void cdot_avx512(std::size_t n, const double* a, const double* b, double& re, double& im) {
+    __m512d acc_r = _mm512_setzero_pd();
+    __m512d acc_i = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m512d va = _mm512_loadu_pd(a + 2 * i);
+        __m512d vb = _mm512_loadu_pd(b + 2 * i);
+        __m512d a_re = _mm512_movedup_pd(va);
+        __m512d a_im = _mm512_permute_pd(va, 0xff);
+        acc_r = _mm512_fmadd_pd(a_re, vb, acc_r);
+        acc_i = _mm512_fmadd_pd(a_im, _mm512_permute_pd(vb, 0x55), acc_i);
+    }
+    alignas(64) double r[8];
+    alignas(64) double s[8];
+    _mm512_store_pd(r, acc_r);
+    _mm512_store_pd(s, acc_i);
+    re += ((r[0] + r[2]) + (r[4] + r[6])) - ((s[0] + s[2]) + (s[4] + s[6]));
+    im += ((r[1] + r[3]) + (r[5] + r[7])) + ((s[1] + s[3]) + (s[5] + s[7]));
+    cdot_scalar(n - i, a + 2 * i, b + 2 * i, re, im);
+}
+
+#endif
+
+static qs::SimdLevel detect_simd() {
+#ifdef QS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return qs::SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return qs::SimdLevel::AVX2;
+    }
+#endif
+    return qs::SimdLevel::SCALAR;
+}
+
+static qs::SimdLevel simd_level = detect_simd();
+
+qs::SimdLevel qs::_simd_supported() {
+    static qs::SimdLevel supported = detect_simd();
+    return supported;
+}
+
+qs::SimdLevel qs::_simd_level() {
+    return simd_level;
+}
+
+void qs::_set_simd_level(qs::SimdLevel level) {
+    qs::SimdLevel supported = qs::_simd_supported();
+    if (level == qs::SimdLevel::AVX512 && supported != qs::SimdLevel::AVX512) {
+        level = supported;
+    }
+    if (level == qs::SimdLevel::AVX2 && supported == qs::SimdLevel::SCALAR) {
+        level = supported;
+    }
+    simd_level = level;
+}
+
+std::string qs::_simd_name(qs::SimdLevel level) {
+    switch (level) {
+    case qs::SimdLevel::AVX512:
+        return "avx512";
+    case qs::SimdLevel::AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+void qs::_caxpy(std::size_t n, const qs::Complex& a, const qs::Complex* x, qs::Complex* y) {
+    const double* px = reinterpret_cast<const double*>(x);
+    double* py = reinterpret_cast<double*>(y);
+    switch (simd_level) {
+#ifdef QS_X86
+    case qs::SimdLevel::AVX512:
+        caxpy_avx512(n, a.Re, a.Im, px, py);
+        return;
+    case qs::SimdLevel::AVX2:
+        caxpy_avx2(n, a.Re, a.Im, px, py);
+        return;
+#endif
+    default:
+        caxpy_scalar(n, a.Re, a.Im, px, py);
+    }
+}
+
+void qs::_cscale(std::size_t n, const qs::Complex& a, const qs::Complex* x, qs::Complex* y) {
+    const double* px = reinterpret_cast<const double*>(x);
+    double* py = reinterpret_cast<double*>(y);
+    switch (simd_level) {
+#ifdef QS_X86
+    case qs::SimdLevel::AVX512:
+        cscale_avx512(n, a.Re, a.Im, px, py);
+        return;
+    case qs::SimdLevel::AVX2:
+        cscale_avx2(n, a.Re, a.Im, px, py);
+        return;
+#endif
+    default:
+        cscale_scalar(n, a.Re, a.Im, px, py);
+    }
+}
+
+qs::Complex qs::_cdot(std::size_t n, const qs::Complex* a, const qs::Complex* b) {
+    const double* pa = reinterpret_cast<const double*>(a);
+    const double* pb = reinterpret_cast<const double*>(b);
+    double re = 0;
+    double im = 0;
+    switch (simd_level) {
+#ifdef QS_X86
+    case qs::SimdLevel::AVX512:
+        cdot_avx512(n, pa, pb, re, im);
+        break;
+    case qs::SimdLevel::AVX2:
+        cdot_avx2(n, pa, pb, re, im);
+        break;
+#endif
+    default:
+        cdot_scalar(n, pa, pb, re, im);
+    }
+    return qs::Complex(re, im);
+}
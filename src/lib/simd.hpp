@@ -0,0 +1,36 @@
+#ifndef __SIMD_HPP__
+#define __SIMD_HPP__
+
+#include <cstddef>
+#include <string>
+
+#include "./complex.hpp"
+
+// complex kernels on interleaved arrays (Re, Im, Re, Im, ...) with explicit AVX2 and AVX-512 versions
+// the best version supported by the processor is selected at runtime, scalar loops are the fallback
+namespace qs {
+
+    // instruction sets with dedicated kernels ordered from the weakest
+    enum SimdLevel : char {
+        SCALAR = 's',
+        AVX2 = '2',
+        AVX512 = '5',
+    };
+
+    // best instruction set supported by the processor
+    SimdLevel _simd_supported();
+    // instruction set currently used by the kernels
+    SimdLevel _simd_level();
+    // select instruction set used by the kernels, it is lowered to the supported one
+    void _set_simd_level(SimdLevel level);
+    std::string _simd_name(SimdLevel level);
+
+    // y[i] += a * x[i]
+    void _caxpy(std::size_t n, const Complex& a, const Complex* x, Complex* y);
+    // y[i] = a * x[i]
+    void _cscale(std::size_t n, const Complex& a, const Complex* x, Complex* y);
+    // sum of a[i] * b[i] (without conjugation)
+    Complex _cdot(std::size_t n, const Complex* a, const Complex* b);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char snapshot_magic[8] = {'Q', 'S', 'S', 'N', 'A', 'P', 0, 0};
+static const std::uint32_t snapshot_version = 1;
+
+static_assert(sizeof(qs::SnapshotHeader) == 64, "snapshot header must have 64 bytes");
+
+// the mapped file is written in blocks which are flushed and released one by one
+// so that a large state does not need as much page cache as its own size
+static const std::size_t snapshot_block = (std::size_t)1 << 28;
+
+// copy bytes between the state and the mapped file in parallel chunks
+static void parallel_copy(char* dst, const char* src, std::size_t n_bytes, int n_threads) {
+    qs::_parallel_for(n_bytes, n_threads, [&](std::size_t begin, std::size_t end) {
+        std::memcpy(dst + begin, src + begin, end - begin);
+    }, 1 << 20);
+}
+
+void qs::_write_snapshot(std::string path, qs::c_vec& state, int n_qubits, std::uint64_t gate, int n_threads) {
+    qs::check_dims("_write_snapshot", state.size(), (std::size_t)1 << n_qubits);
+
+    qs::SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = snapshot_version;
+    header.n_qubits = n_qubits;
+    header.precision = sizeof(double);
+    header.layout = qs::snapshot_interleaved;
+    header.gate = gate;
+
+    std::size_t n_bytes = state.size() * sizeof(qs::Complex);
+    std::size_t size = sizeof(header) + n_bytes;
+    std::string temporary = path + ".tmp";
+
+    int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    qs::check_err(fd < 0, "_write_snapshot", "cannot create snapshot file " + temporary);
+    qs::check_err(ftruncate(fd, size) != 0, "_write_snapshot", "cannot resize snapshot file " + temporary);
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    qs::check_err(map == MAP_FAILED, "_write_snapshot", "cannot map snapshot file " + temporary);
+
+    char* bytes = static_cast<char*>(map);
+    const char* amplitudes = reinterpret_cast<const char*>(state.data());
+    std::memcpy(bytes, &header, sizeof(header));
+    for (std::size_t begin = 0; begin < size; begin += snapshot_block) {
+        std::size_t end = std::min(begin + snapshot_block, size);
+        std::size_t from = std::max(begin, sizeof(header));
+        parallel_copy(bytes + from, amplitudes + from - sizeof(header), end - from, n_threads);
+        // the data has to reach the disk before the file replaces the previous snapshot
+        qs::check_err(msync(bytes + begin, end - begin, MS_SYNC) != 0, "_write_snapshot", "cannot write snapshot file " + temporary);
+        madvise(bytes + begin, end - begin, MADV_DONTNEED);
+    }
+    munmap(map, size);
+    close(fd);
+    qs::check_err(rename(temporary.c_str(), path.c_str()) != 0, "_write_snapshot", "cannot rename snapshot file to " + path);
+}
+
+qs::SnapshotHeader qs::_read_snapshot_header(std::string path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    qs::check_err(fd < 0, "_read_snapshot", "cannot open snapshot file " + path);
+
+    qs::SnapshotHeader header;
+    ssize_t n_read = read(fd, &header, sizeof(header));
+    struct stat info;
+    bool stat_ok = fstat(fd, &info) == 0;
+    close(fd);
+
+    qs::check_err(n_read != sizeof(header) || std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0, "_read_snapshot", "file is not a snapshot");
+    qs::check_err(header.version != snapshot_version, "_read_snapshot", "unsupported snapshot version");
+    qs::check_err(header.precision != sizeof(double) || header.layout != qs::snapshot_interleaved, "_read_snapshot", "unsupported precision or layout of amplitudes");
+    qs::check_err(header.n_qubits < 1 || header.n_qubits > 62, "_read_snapshot", "invalid number of qubits");
+    qs::check_err(!stat_ok || (std::size_t)info.st_size != sizeof(header) + ((std::size_t)1 << header.n_qubits) * sizeof(qs::Complex), "_read_snapshot", "snapshot file is truncated");
+    return header;
+}
+
+qs::c_vec qs::_read_snapshot(std::string path, int n_threads) {
+    qs::SnapshotHeader header = qs::_read_snapshot_header(path);
+    std::size_t dim = (std::size_t)1 << header.n_qubits;
+    std::size_t n_bytes = dim * sizeof(qs::Complex);
+    std::size_t size = sizeof(header) + n_bytes;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    qs::check_err(fd < 0, "_read_snapshot", "cannot open snapshot file " + path);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    qs::check_err(map == MAP_FAILED, "_read_snapshot", "cannot map snapshot file " + path);
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    qs::c_vec state(dim);
+    parallel_copy(reinterpret_cast<char*>(state.data()), static_cast<const char*>(map) + sizeof(header), n_bytes, n_threads);
+    munmap(map, size);
+    return state;
+}
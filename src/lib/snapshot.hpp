@@ -0,0 +1,45 @@
+#ifndef __SNAPSHOT_HPP__
+#define __SNAPSHOT_HPP__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "../utils/err.hpp"
+#include "../utils/parallel.hpp"
+#include "./complex.hpp"
+#include "./vec_op.hpp"
+
+// binary snapshots of a state vector stored as a fixed header followed by the amplitudes
+// the files are written and read through memory maps, so the amplitudes are copied in parallel without stream buffers
+namespace qs {
+
+    // amplitudes are pairs of real and imaginary part, amplitude i is basis state i and qubit 0 is its most significant bit
+    constexpr std::uint32_t snapshot_interleaved = 0;
+
+    // header at the start of a snapshot file, padded to 64 bytes so that the amplitudes stay aligned
+    struct SnapshotHeader {
+        // "QSSNAP" followed by zeros
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t n_qubits;
+        // bytes of a real number, 8 for double
+        std::uint32_t precision;
+        std::uint32_t layout;
+        // number of gates of the circuit applied to the state
+        std::uint64_t gate;
+        char padding[32];
+    };
+
+    // write the state of n qubits after gate gates of the circuit to the file
+    // the file is written under a temporary name and renamed, so a preempted write never replaces the previous snapshot
+    void _write_snapshot(std::string path, c_vec& state, int n_qubits, std::uint64_t gate, int n_threads = 1);
+
+    // read the header of a snapshot file and check that it was written by _write_snapshot
+    SnapshotHeader _read_snapshot_header(std::string path);
+
+    // read the amplitudes of a snapshot file
+    c_vec _read_snapshot(std::string path, int n_threads = 1);
+};
+
+#endif
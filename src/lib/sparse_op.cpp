@@ -0,0 +1,208 @@
+#include "./sparse_op.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <utility>
+
+#include "./sv_op.hpp"
+
+// gather the given bits of index i into a local index, bits[0] becomes the most significant bit
+static std::size_t gather(std::size_t i, std::vector<int>& bits) {
+    std::size_t local = 0;
+    for (int bit : bits) {
+        local = (local << 1) | ((i >> bit) & 1);
+    }
+    return local;
+}
+
+static bool is_small(qs::Complex& x) {
+    return x.Re * x.Re + x.Im * x.Im < qs::sparse_tolerance;
+}
+
+// sort the pairs of indices and amplitudes by index after the indices were moved
+static void sort_state(qs::SparseVec& state) {
+    std::size_t nnz = state.indices.size();
+    std::vector<std::size_t> order(nnz);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return state.indices[a] < state.indices[b]; });
+
+    qs::SparseVec sorted;
+    sorted.indices.reserve(nnz);
+    sorted.amplitudes.reserve(nnz);
+    for (std::size_t i : order) {
+        sorted.indices.push_back(state.indices[i]);
+        sorted.amplitudes.push_back(state.amplitudes[i]);
+    }
+    state = std::move(sorted);
+}
+
+qs::SparseVec qs::_sparse_product(std::vector<qs::c_vec>& kets) {
+    qs::SparseVec state;
+    state.indices.push_back(0);
+    state.amplitudes.push_back(qs::Complex(1));
+
+    // appending a qubit as the least significant bit keeps the indices sorted
+    for (qs::c_vec& ket : kets) {
+        qs::check_dims("_sparse_product", ket.size(), 2);
+        qs::SparseVec next;
+        for (std::size_t i = 0; i < qs::_nnz(state); ++i) {
+            for (std::size_t s = 0; s < 2; ++s) {
+                qs::Complex x = state.amplitudes[i] * ket[s];
+                if (!is_small(x)) {
+                    next.indices.push_back((state.indices[i] << 1) | s);
+                    next.amplitudes.push_back(x);
+                }
+            }
+        }
+        state = std::move(next);
+    }
+    return state;
+}
+
+qs::c_vec qs::_to_dense(qs::SparseVec& state, std::size_t dim) {
+    qs::c_vec dense(dim);
+    for (std::size_t i = 0; i < qs::_nnz(state); ++i) {
+        qs::check_err(state.indices[i] >= dim, "_to_dense", "index out of range");
+        dense[state.indices[i]] = state.amplitudes[i];
+    }
+    return dense;
+}
+
+qs::SparseVec qs::_to_sparse(qs::c_vec& state) {
+    qs::SparseVec sparse;
+    for (std::size_t i = 0; i < state.size(); ++i) {
+        if (!is_small(state[i])) {
+            sparse.indices.push_back(i);
+            sparse.amplitudes.push_back(state[i]);
+        }
+    }
+    return sparse;
+}
+
+void qs::_sparse_apply_kq(qs::SparseVec& state, qs::c_mat& m, std::vector<int>& bits, std::vector<int>& controls) {
+    int k = bits.size();
+    std::size_t local_dim = (std::size_t)1 << k;
+    qs::check_dims("_sparse_apply_kq", m.size(), local_dim);
+
+    std::size_t control_mask = qs::_mask(controls);
+    std::size_t target_mask = qs::_mask(bits);
+    std::vector<std::size_t> offsets = qs::_local_offsets(bits);
+
+    // group the affected amplitudes by their index with the target bits cleared
+    std::vector<std::pair<std::size_t, std::size_t>> groups;
+    qs::SparseVec next;
+    for (std::size_t i = 0; i < qs::_nnz(state); ++i) {
+        std::size_t index = state.indices[i];
+        if ((index & control_mask) == control_mask) {
+            groups.push_back({index & ~target_mask, i});
+        } else {
+            next.indices.push_back(index);
+            next.amplitudes.push_back(state.amplitudes[i]);
+        }
+    }
+    std::sort(groups.begin(), groups.end());
+
+    // every group is multiplied by the columns of its populated local basis states
+    for (std::size_t begin = 0; begin < groups.size();) {
+        std::size_t base = groups[begin].first;
+        std::size_t end = begin;
+        while (end < groups.size() && groups[end].first == base) {
+            ++end;
+        }
+        for (std::size_t r = 0; r < local_dim; ++r) {
+            qs::Complex x;
+            for (std::size_t g = begin; g < end; ++g) {
+                std::size_t i = groups[g].second;
+                x += m[r][gather(state.indices[i], bits)] * state.amplitudes[i];
+            }
+            if (!is_small(x)) {
+                next.indices.push_back(base | offsets[r]);
+                next.amplitudes.push_back(x);
+            }
+        }
+        begin = end;
+    }
+
+    sort_state(next);
+    state = std::move(next);
+}
+
+void qs::_sparse_apply_diagonal(qs::SparseVec& state, qs::c_vec& diag, std::vector<int>& bits, std::vector<int>& controls) {
+    qs::check_dims("_sparse_apply_diagonal", diag.size(), (std::size_t)1 << bits.size());
+
+    // the indices do not move, so the order is kept
+    std::size_t control_mask = qs::_mask(controls);
+    for (std::size_t i = 0; i < qs::_nnz(state); ++i) {
+        if ((state.indices[i] & control_mask) == control_mask) {
+            state.amplitudes[i] = state.amplitudes[i] * diag[gather(state.indices[i], bits)];
+        }
+    }
+}
+
+void qs::_sparse_apply_permutation(qs::SparseVec& state, std::vector<std::size_t>& perm, qs::c_vec& phases, std::vector<int>& bits, std::vector<int>& controls) {
+    std::size_t local_dim = (std::size_t)1 << bits.size();
+    qs::check_dims("_sparse_apply_permutation", perm.size(), local_dim);
+    qs::check_dims("_sparse_apply_permutation", phases.size(), local_dim);
+
+    std::size_t control_mask = qs::_mask(controls);
+    std::size_t target_mask = qs::_mask(bits);
+    std::vector<std::size_t> offsets = qs::_local_offsets(bits);
+    for (std::size_t i = 0; i < qs::_nnz(state); ++i) {
+        std::size_t index = state.indices[i];
+        if ((index & control_mask) == control_mask) {
+            std::size_t c = gather(index, bits);
+            state.indices[i] = (index & ~target_mask) | offsets[perm[c]];
+            state.amplitudes[i] = state.amplitudes[i] * phases[c];
+        }
+    }
+    sort_state(state);
+}
+
+void qs::_sparse_apply_function(qs::SparseVec& state, std::vector<std::size_t>& table, std::vector<int>& input_bits, std::vector<int>& output_bits) {
+    std::size_t n_outputs = (std::size_t)1 << output_bits.size();
+    qs::check_dims("_sparse_apply_function", table.size(), (std::size_t)1 << input_bits.size());
+
+    // f is evaluated only for the populated inputs
+    std::vector<std::size_t> offsets = qs::_local_offsets(output_bits);
+    for (std::size_t& index : state.indices) {
+        std::size_t value = table[gather(index, input_bits)];
+        qs::check_err(value >= n_outputs, "_sparse_apply_function", "function value out of range");
+        index ^= offsets[value];
+    }
+    sort_state(state);
+}
+
+std::map<std::size_t, double> qs::_sparse_probabilities(qs::SparseVec& state, std::vector<int>& bits) {
+    std::map<std::size_t, double> probs;
+    for (std::size_t i = 0; i < qs::_nnz(state); ++i) {
+        qs::Complex& x = state.amplitudes[i];
+        probs[gather(state.indices[i], bits)] += x.Re * x.Re + x.Im * x.Im;
+    }
+    return probs;
+}
+
+double qs::_sparse_norm2(qs::SparseVec& state) {
+    double norm = 0;
+    for (qs::Complex& x : state.amplitudes) {
+        norm += x.Re * x.Re + x.Im * x.Im;
+    }
+    return norm;
+}
+
+void qs::print_sparse(qs::SparseVec& state, int n_qubits) {
+    std::cout << "{";
+    for (std::size_t i = 0; i < qs::_nnz(state); ++i) {
+        if (i != 0) {
+            std::cout << ", ";
+        }
+        std::string bits(n_qubits, '0');
+        for (int q = 0; q < n_qubits; ++q) {
+            if ((state.indices[i] >> (n_qubits - 1 - q)) & 1) {
+                bits[q] = '1';
+            }
+        }
+        std::cout << "|" << bits << ">: " << state.amplitudes[i].str();
+    }
+    std::cout << "}";
+}
@@ -0,0 +1,66 @@
+#ifndef __SPARSE_OP_HPP__
+#define __SPARSE_OP_HPP__
+
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "../utils/err.hpp"
+#include "./complex.hpp"
+#include "./vec_op.hpp"
+
+// operations on a sparse state vector which stores only the populated basis states
+// qubits are addressed by their bit position in the amplitude index (0 is the least significant bit)
+// every operation costs O(nnz) up to sorting and visits only the stored amplitudes
+namespace qs {
+
+    // nonzero amplitudes of a state vector sorted by their index
+    struct SparseVec {
+        std::vector<std::size_t> indices;
+        c_vec amplitudes;
+    };
+
+    // amplitudes with squared magnitude below this value are dropped from the sparse state
+    constexpr double sparse_tolerance = 1e-30;
+
+    // number of stored amplitudes
+    inline std::size_t _nnz(SparseVec& state) {
+        return state.indices.size();
+    }
+
+    // tensor product of single-qubit states, kets[0] is the most significant qubit
+    SparseVec _sparse_product(std::vector<c_vec>& kets);
+
+    // convert between the dense and the sparse representation
+    c_vec _to_dense(SparseVec& state, std::size_t dim);
+    SparseVec _to_sparse(c_vec& state);
+
+    // apply 2^k x 2^k matrix m to the k qubits at bit positions bits only where all control bits are set
+    // bits[0] corresponds to the most significant bit of the row/column index of m
+    void _sparse_apply_kq(SparseVec& state, c_mat& m, std::vector<int>& bits, std::vector<int>& controls);
+
+    // multiply the amplitudes by the diagonal diag of a matrix acting on the qubits at bit positions bits
+    // only where all control bits are set, bits[0] corresponds to the most significant bit of the index of diag
+    void _sparse_apply_diagonal(SparseVec& state, c_vec& diag, std::vector<int>& bits, std::vector<int>& controls);
+
+    // move the amplitude of local basis state c to local basis state perm[c] multiplied by phases[c]
+    // on the qubits at bit positions bits only where all control bits are set
+    void _sparse_apply_permutation(SparseVec& state, std::vector<std::size_t>& perm, c_vec& phases, std::vector<int>& bits, std::vector<int>& controls);
+
+    // apply reversible classical function |x>|y> -> |x>|y xor f(x)> given by the table f(x) = table[x]
+    // x is read from the qubits at bit positions input_bits and y from output_bits, the first ones are the most significant
+    void _sparse_apply_function(SparseVec& state, std::vector<std::size_t>& table, std::vector<int>& input_bits, std::vector<int>& output_bits);
+
+    // marginal probability distribution over the qubits at bit positions bits, only outcomes with nonzero probability are listed
+    // bits[0] corresponds to the most significant bit of the outcome
+    std::map<std::size_t, double> _sparse_probabilities(SparseVec& state, std::vector<int>& bits);
+
+    // compute squared norm of the state
+    double _sparse_norm2(SparseVec& state);
+
+    // print the populated basis states of n qubits with their amplitudes, i.e. {|00>: 0.707, |11>: 0.707}
+    void print_sparse(SparseVec& state, int n_qubits);
+};
+
+#endif
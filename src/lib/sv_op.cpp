@@ -0,0 +1,515 @@
+#include "sv_op.hpp"
+
+#include <algorithm>
+
+// number of bytes needed to address dim amplitudes
+static int index_bytes(std::size_t dim) {
+    int n_bytes = 1;
+    while (n_bytes < 8 && ((std::size_t)1 << (8 * n_bytes)) < dim) {
+        ++n_bytes;
+    }
+    return n_bytes;
+}
+
+// lookup tables which gather the given bits of an index byte by byte into a local index
+// bits[0] becomes the most significant bit of the local index
+static std::vector<std::vector<std::size_t>> gather_tables(std::vector<int>& bits, int n_bytes) {
+    int k = bits.size();
+    std::vector<std::vector<std::size_t>> tables(n_bytes, std::vector<std::size_t>(256, 0));
+    for (int j = 0; j < k; ++j) {
+        std::size_t local_bit = (std::size_t)1 << (k - 1 - j);
+        for (int value = 0; value < 256; ++value) {
+            if ((value >> (bits[j] % 8)) & 1) {
+                tables[bits[j] / 8][value] |= local_bit;
+            }
+        }
+    }
+    return tables;
+}
+
+// inverse of gather tables, they scatter bytes of a local index to the given bits of an index
+static std::vector<std::vector<std::size_t>> scatter_tables(std::vector<int>& bits, int n_bytes) {
+    int k = bits.size();
+    std::vector<std::vector<std::size_t>> tables(n_bytes, std::vector<std::size_t>(256, 0));
+    for (int j = 0; j < k; ++j) {
+        int local_bit = k - 1 - j;
+        for (int value = 0; value < 256; ++value) {
+            if ((value >> (local_bit % 8)) & 1) {
+                tables[local_bit / 8][value] |= (std::size_t)1 << bits[j];
+            }
+        }
+    }
+    return tables;
+}
+
+static std::size_t lookup(std::vector<std::vector<std::size_t>>& tables, std::size_t i) {
+    std::size_t r = 0;
+    for (int byte = 0; byte < tables.size(); ++byte) {
+        r |= tables[byte][(i >> (8 * byte)) & 0xff];
+    }
+    return r;
+}
+
+void qs::_apply_1q(qs::c_vec& state, qs::c_mat& m, int bit, int n_threads) {
+    qs::check_dims("_apply_1q", m.size(), 2);
+
+    std::size_t dim = state.size();
+    std::size_t stride = (std::size_t)1 << bit;
+
+    qs::check_err(stride >= dim, "_apply_1q", "qubit out of range");
+
+    double m00r = m[0][0].Re, m00i = m[0][0].Im;
+    double m01r = m[0][1].Re, m01i = m[0][1].Im;
+    double m10r = m[1][0].Re, m10i = m[1][0].Im;
+    double m11r = m[1][1].Re, m11i = m[1][1].Im;
+
+    // visit every pair of amplitudes which differ only in the target bit
+    qs::_parallel_for(dim / 2, n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            std::size_t i0 = ((p >> bit) << (bit + 1)) | (p & (stride - 1));
+            std::size_t i1 = i0 | stride;
+            double ar = state[i0].Re, ai = state[i0].Im;
+            double br = state[i1].Re, bi = state[i1].Im;
+            state[i0].Re = m00r * ar - m00i * ai + m01r * br - m01i * bi;
+            state[i0].Im = m00r * ai + m00i * ar + m01r * bi + m01i * br;
+            state[i1].Re = m10r * ar - m10i * ai + m11r * br - m11i * bi;
+            state[i1].Im = m10r * ai + m10i * ar + m11r * bi + m11i * br;
+        }
+    });
+}
+
+void qs::_apply_c1q(qs::c_vec& state, qs::c_mat& m, int bit, std::vector<int>& controls, int n_threads) {
+    qs::check_dims("_apply_c1q", m.size(), 2);
+
+    if (controls.empty()) {
+        qs::_apply_1q(state, m, bit, n_threads);
+        return;
+    }
+
+    std::size_t dim = state.size();
+    std::size_t stride = (std::size_t)1 << bit;
+    std::size_t control_mask = qs::_mask(controls);
+
+    qs::check_err(stride >= dim || control_mask >= dim, "_apply_c1q", "qubit out of range");
+
+    std::vector<int> sorted_bits(controls);
+    sorted_bits.push_back(bit);
+    std::sort(sorted_bits.begin(), sorted_bits.end());
+
+    double m00r = m[0][0].Re, m00i = m[0][0].Im;
+    double m01r = m[0][1].Re, m01i = m[0][1].Im;
+    double m10r = m[1][0].Re, m10i = m[1][0].Im;
+    double m11r = m[1][1].Re, m11i = m[1][1].Im;
+
+    // visit only the pairs whose control bits are all set
+    std::size_t n_pairs = dim >> sorted_bits.size();
+    qs::_parallel_for(n_pairs, n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            std::size_t i0 = qs::_insert_zeros(p, sorted_bits) | control_mask;
+            std::size_t i1 = i0 | stride;
+            double ar = state[i0].Re, ai = state[i0].Im;
+            double br = state[i1].Re, bi = state[i1].Im;
+            state[i0].Re = m00r * ar - m00i * ai + m01r * br - m01i * bi;
+            state[i0].Im = m00r * ai + m00i * ar + m01r * bi + m01i * br;
+            state[i1].Re = m10r * ar - m10i * ai + m11r * br - m11i * bi;
+            state[i1].Im = m10r * ai + m10i * ar + m11r * bi + m11i * br;
+        }
+    });
+}
+
+void qs::_apply_kq(qs::c_vec& state, qs::c_mat& m, std::vector<int>& bits, std::vector<int>& controls, int n_threads) {
+    int k = bits.size();
+    std::size_t local_dim = (std::size_t)1 << k;
+
+    qs::check_dims("_apply_kq", m.size(), local_dim);
+
+    if (k == 1) {
+        qs::_apply_c1q(state, m, bits[0], controls, n_threads);
+        return;
+    }
+
+    std::size_t dim = state.size();
+    std::size_t control_mask = qs::_mask(controls);
+    qs::check_err(local_dim > dim || control_mask >= dim, "_apply_kq", "too many qubits for the state");
+
+    std::vector<int> sorted_bits(bits);
+    sorted_bits.insert(sorted_bits.end(), controls.begin(), controls.end());
+    std::sort(sorted_bits.begin(), sorted_bits.end());
+    std::vector<std::size_t> offsets = qs::_local_offsets(bits);
+
+    std::size_t n_blocks = dim >> sorted_bits.size();
+    // every block costs local_dim^2 operations
+    std::size_t min_chunk = std::max((std::size_t)1, ((std::size_t)1 << 14) / (local_dim * local_dim));
+    qs::_parallel_for(n_blocks, n_threads, [&](std::size_t begin, std::size_t end) {
+        qs::c_vec local(local_dim);
+        for (std::size_t b = begin; b < end; ++b) {
+            std::size_t base = qs::_insert_zeros(b, sorted_bits) | control_mask;
+
+            // gather the amplitudes of the local subspace
+            for (std::size_t r = 0; r < local_dim; ++r) {
+                local[r] = state[base + offsets[r]];
+            }
+
+            // multiply them by the local matrix and scatter them back
+            for (std::size_t r = 0; r < local_dim; ++r) {
+                double re = 0;
+                double im = 0;
+                for (std::size_t c = 0; c < local_dim; ++c) {
+                    re += m[r][c].Re * local[c].Re - m[r][c].Im * local[c].Im;
+                    im += m[r][c].Re * local[c].Im + m[r][c].Im * local[c].Re;
+                }
+                state[base + offsets[r]] = qs::Complex(re, im);
+            }
+        }
+    }, min_chunk);
+}
+
+void qs::_apply_diagonal(qs::c_vec& state, qs::c_vec& diag, std::vector<int>& bits, std::vector<int>& controls, int n_threads) {
+    int k = bits.size();
+    std::size_t local_dim = (std::size_t)1 << k;
+
+    qs::check_dims("_apply_diagonal", diag.size(), local_dim);
+
+    std::size_t dim = state.size();
+    std::size_t control_mask = qs::_mask(controls);
+    qs::check_err(local_dim > dim || control_mask >= dim || qs::_mask(bits) >= dim, "_apply_diagonal", "qubit out of range");
+
+    // only local states with a nontrivial phase are visited, i.e. half of the amplitudes for Z or CZ
+    std::vector<std::size_t> active;
+    for (std::size_t r = 0; r < local_dim; ++r) {
+        if (diag[r].Re != 1 || diag[r].Im != 0) {
+            active.push_back(r);
+        }
+    }
+    if (active.empty()) {
+        return;
+    }
+
+    std::vector<int> sorted_bits(bits);
+    sorted_bits.insert(sorted_bits.end(), controls.begin(), controls.end());
+    std::sort(sorted_bits.begin(), sorted_bits.end());
+    std::vector<std::size_t> offsets = qs::_local_offsets(bits);
+
+    std::size_t n_blocks = dim >> sorted_bits.size();
+    std::size_t min_chunk = std::max((std::size_t)1, ((std::size_t)1 << 14) / active.size());
+    qs::_parallel_for(n_blocks, n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b) {
+            std::size_t base = qs::_insert_zeros(b, sorted_bits) | control_mask;
+            for (std::size_t r : active) {
+                std::size_t i = base + offsets[r];
+                double re = state[i].Re;
+                double im = state[i].Im;
+                state[i].Re = diag[r].Re * re - diag[r].Im * im;
+                state[i].Im = diag[r].Re * im + diag[r].Im * re;
+            }
+        }
+    }, min_chunk);
+}
+
+void qs::_apply_permutation(qs::c_vec& state, std::vector<std::size_t>& perm, qs::c_vec& phases, std::vector<int>& bits, std::vector<int>& controls, int n_threads) {
+    int k = bits.size();
+    std::size_t local_dim = (std::size_t)1 << k;
+
+    qs::check_dims("_apply_permutation", perm.size(), local_dim);
+    qs::check_dims("_apply_permutation", phases.size(), local_dim);
+
+    std::size_t dim = state.size();
+    std::size_t control_mask = qs::_mask(controls);
+    qs::check_err(local_dim > dim || control_mask >= dim || qs::_mask(bits) >= dim, "_apply_permutation", "qubit out of range");
+
+    // local states which stay in place with unit phase are not visited
+    std::vector<std::size_t> moved;
+    bool unit_phases = true;
+    for (std::size_t c = 0; c < local_dim; ++c) {
+        bool unit = phases[c].Re == 1 && phases[c].Im == 0;
+        if (perm[c] != c || !unit) {
+            moved.push_back(c);
+            unit_phases = unit_phases && unit;
+        }
+    }
+    if (moved.empty()) {
+        return;
+    }
+
+    std::vector<int> sorted_bits(bits);
+    sorted_bits.insert(sorted_bits.end(), controls.begin(), controls.end());
+    std::sort(sorted_bits.begin(), sorted_bits.end());
+    std::vector<std::size_t> offsets = qs::_local_offsets(bits);
+
+    std::size_t n_blocks = dim >> sorted_bits.size();
+    std::size_t min_chunk = std::max((std::size_t)1, ((std::size_t)1 << 14) / moved.size());
+    qs::_parallel_for(n_blocks, n_threads, [&](std::size_t begin, std::size_t end) {
+        qs::c_vec local(local_dim);
+        for (std::size_t b = begin; b < end; ++b) {
+            std::size_t base = qs::_insert_zeros(b, sorted_bits) | control_mask;
+
+            // copy the moved amplitudes first, the permutation maps them onto each other
+            for (std::size_t c : moved) {
+                local[c] = state[base + offsets[c]];
+            }
+
+            if (unit_phases) {
+                for (std::size_t c : moved) {
+                    state[base + offsets[perm[c]]] = local[c];
+                }
+                continue;
+            }
+
+            for (std::size_t c : moved) {
+                std::size_t i = base + offsets[perm[c]];
+                state[i].Re = phases[c].Re * local[c].Re - phases[c].Im * local[c].Im;
+                state[i].Im = phases[c].Re * local[c].Im + phases[c].Im * local[c].Re;
+            }
+        }
+    }, min_chunk);
+}
+
+void qs::_apply_function(qs::c_vec& state, std::vector<std::size_t>& table, std::vector<int>& input_bits, std::vector<int>& output_bits, int n_threads) {
+    std::size_t dim = state.size();
+    std::size_t n_inputs = (std::size_t)1 << input_bits.size();
+    std::size_t n_outputs = (std::size_t)1 << output_bits.size();
+
+    qs::check_dims("_apply_function", table.size(), n_inputs);
+    qs::check_err(qs::_mask(input_bits) >= dim || qs::_mask(output_bits) >= dim, "_apply_function", "qubit out of range");
+    qs::check_err(*std::max_element(table.begin(), table.end()) >= n_outputs, "_apply_function", "function value out of range");
+
+    // convert every value f(x) into the mask of output bits which are flipped for input x
+    std::vector<std::vector<std::size_t>> output_tables = scatter_tables(output_bits, index_bytes(n_outputs));
+    std::vector<std::size_t> flips(n_inputs);
+    qs::_parallel_for(n_inputs, n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t x = begin; x < end; ++x) {
+            flips[x] = lookup(output_tables, table[x]);
+        }
+    });
+
+    // |x>|y> -> |x>|y xor f(x)> swaps pairs of amplitudes, every pair is swapped by its smaller index
+    std::vector<std::vector<std::size_t>> input_tables = gather_tables(input_bits, index_bytes(dim));
+    qs::_parallel_for(dim, n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::size_t j = i ^ flips[lookup(input_tables, i)];
+            if (i < j) {
+                std::swap(state[i], state[j]);
+            }
+        }
+    });
+}
+
+std::vector<double> qs::_probabilities(qs::c_vec& state, std::vector<int>& bits, int n_threads) {
+    int k = bits.size();
+    std::size_t dim = state.size();
+    std::size_t local_dim = (std::size_t)1 << k;
+    int n_bytes = index_bytes(dim);
+
+    for (int bit : bits) {
+        qs::check_err((std::size_t)1 << bit >= dim, "_probabilities", "qubit out of range");
+    }
+
+    std::vector<double> probs(local_dim, 0.0);
+
+    // few outcomes, every chunk of amplitudes fills its own histogram and the histograms are added in order
+    if (local_dim <= 256) {
+        std::vector<std::vector<std::size_t>> tables = gather_tables(bits, n_bytes);
+        std::size_t chunk = qs::_chunk_size(dim, 1 << 14);
+        std::vector<std::vector<double>> partial((dim + chunk - 1) / chunk);
+        qs::_parallel_for(dim, n_threads, [&](std::size_t begin, std::size_t end) {
+            std::vector<double> hist(local_dim, 0.0);
+            for (std::size_t i = begin; i < end; ++i) {
+                hist[lookup(tables, i)] += state[i].Re * state[i].Re + state[i].Im * state[i].Im;
+            }
+            partial[begin / chunk] = hist;
+        });
+        for (std::vector<double>& hist : partial) {
+            for (std::size_t r = 0; r < local_dim; ++r) {
+                probs[r] += hist[r];
+            }
+        }
+        return probs;
+    }
+
+    // many outcomes, every outcome sums the amplitudes of all values of the unmeasured qubits
+    std::vector<int> unmeasured;
+    std::size_t measured_mask = qs::_mask(bits);
+    for (int bit = 0; ((std::size_t)1 << bit) < dim; ++bit) {
+        if (!((measured_mask >> bit) & 1)) {
+            unmeasured.push_back(bit);
+        }
+    }
+    // unmeasured bits are listed from the most significant one so that the inner loop walks memory in order
+    std::reverse(unmeasured.begin(), unmeasured.end());
+    std::vector<std::vector<std::size_t>> measured_tables = scatter_tables(bits, n_bytes);
+    std::vector<std::vector<std::size_t>> unmeasured_tables = scatter_tables(unmeasured, n_bytes);
+    std::size_t n_rest = dim >> k;
+
+    std::size_t min_chunk = std::max((std::size_t)1, ((std::size_t)1 << 14) / n_rest);
+    qs::_parallel_for(local_dim, n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t r = begin; r < end; ++r) {
+            std::size_t base = lookup(measured_tables, r);
+            double p = 0.0;
+            for (std::size_t u = 0; u < n_rest; ++u) {
+                std::size_t i = base | lookup(unmeasured_tables, u);
+                p += state[i].Re * state[i].Re + state[i].Im * state[i].Im;
+            }
+            probs[r] = p;
+        }
+    }, min_chunk);
+    return probs;
+}
+
+qs::c_vec qs::_pauli_expectations(qs::c_vec& state, std::size_t x_mask, std::vector<std::size_t>& z_masks, int n_threads) {
+    std::size_t dim = state.size();
+    std::size_t n_masks = z_masks.size();
+    qs::check_err(x_mask >= dim, "_pauli_expectations", "qubit out of range");
+
+    // amplitudes k and k ^ x give complex conjugate products, so only k with the highest bit of x cleared are visited
+    // and the pair adds s(k) (p + c conj(p)) where c is the parity of x & z
+    int top = -1;
+    for (int bit = 0; (x_mask >> bit) != 0; ++bit) {
+        top = bit;
+    }
+    std::size_t n = top < 0 ? dim : dim >> 1;
+    // all bits are low without a flip, so k = h
+    std::size_t low = top < 0 ? ~(std::size_t)0 : ((std::size_t)1 << top) - 1;
+    std::vector<int> odd(n_masks);
+    for (std::size_t t = 0; t < n_masks; ++t) {
+        odd[t] = __builtin_popcountll(x_mask & z_masks[t]) & 1;
+    }
+    const std::size_t* z = z_masks.data();
+    const int* o = odd.data();
+
+    // every chunk sums its own values and the partial sums are added in order
+    std::size_t chunk = qs::_chunk_size(n, 1 << 14);
+    std::vector<std::vector<double>> partial((n + chunk - 1) / chunk);
+    qs::_parallel_for(n, n_threads, [&](std::size_t begin, std::size_t end) {
+        std::vector<double> sums(n_masks, 0.0);
+        double* sum = sums.data();
+        for (std::size_t h = begin; h < end; ++h) {
+            std::size_t k = ((h & ~low) << 1) | (h & low);
+            qs::Complex& a = state[k ^ x_mask];
+            qs::Complex& b = state[k];
+            // p = conj(a) b, the pair doubles its real or imaginary part, the sign is taken without branches
+            double pair[2] = {2 * (a.Re * b.Re + a.Im * b.Im), 2 * (a.Re * b.Im - a.Im * b.Re)};
+            if (top < 0) {
+                pair[0] = b.Re * b.Re + b.Im * b.Im;
+            }
+            for (std::size_t t = 0; t < n_masks; ++t) {
+                sum[t] += (1 - 2 * (__builtin_popcountll(k & z[t]) & 1)) * pair[o[t]];
+            }
+        }
+        partial[begin / chunk] = sums;
+    });
+
+    qs::c_vec values(n_masks);
+    for (std::vector<double>& sums : partial) {
+        for (std::size_t t = 0; t < n_masks; ++t) {
+            // odd pairs contribute 2i Im(p)
+            if (top >= 0 && odd[t]) {
+                values[t].Im += sums[t];
+            } else {
+                values[t].Re += sums[t];
+            }
+        }
+    }
+    return values;
+}
+
+void qs::_add_pauli(qs::c_vec& state, qs::c_vec& out, std::size_t x_mask, std::size_t z_mask, qs::Complex coefficient, int n_threads) {
+    qs::check_dims("_add_pauli", out.size(), state.size());
+    qs::check_err(x_mask >= state.size(), "_add_pauli", "qubit out of range");
+
+    // every chunk writes the flipped indices of its own amplitudes, which are distinct
+    qs::_parallel_for(state.size(), n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            double sign = 1 - 2 * (__builtin_popcountll(k & z_mask) & 1);
+            qs::Complex& x = state[k];
+            qs::Complex& y = out[k ^ x_mask];
+            y.Re += sign * (coefficient.Re * x.Re - coefficient.Im * x.Im);
+            y.Im += sign * (coefficient.Re * x.Im + coefficient.Im * x.Re);
+        }
+    });
+}
+
+double qs::_real_overlap(qs::c_vec& a, qs::c_vec& b, int n_threads) {
+    qs::check_dims("_real_overlap", a.size(), b.size());
+    return qs::_parallel_sum(a.size(), n_threads, [&](std::size_t begin, std::size_t end) {
+        double sum = 0.0;
+        for (std::size_t i = begin; i < end; ++i) {
+            sum += a[i].Re * b[i].Re + a[i].Im * b[i].Im;
+        }
+        return sum;
+    });
+}
+
+double qs::_norm2(qs::c_vec& state, int n_threads) {
+    return qs::_parallel_sum(state.size(), n_threads, [&](std::size_t begin, std::size_t end) {
+        double sum = 0.0;
+        for (std::size_t i = begin; i < end; ++i) {
+            sum += state[i].Re * state[i].Re + state[i].Im * state[i].Im;
+        }
+        return sum;
+    });
+}
+
+void qs::_collapse(qs::c_vec& state, int bit, int outcome, int target, double p, int n_threads) {
+    qs::check_err(p <= 0, "_collapse", "outcome has zero probability");
+
+    std::size_t stride = (std::size_t)1 << bit;
+    std::size_t half = state.size() >> 1;
+    double scale = 1.0 / sqrt(p);
+    qs::_parallel_for(half, n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            // pair of amplitudes which differ only in the bit
+            std::size_t i0 = ((k >> bit) << (bit + 1)) | (k & (stride - 1));
+            std::size_t i1 = i0 | stride;
+            qs::Complex kept = outcome ? state[i1] : state[i0];
+            kept.Re *= scale;
+            kept.Im *= scale;
+            state[i0] = target ? qs::Complex() : kept;
+            state[i1] = target ? kept : qs::Complex();
+        }
+    });
+}
+
+void qs::_normalize(qs::c_vec& state, int n_threads) {
+    double norm2 = qs::_norm2(state, n_threads);
+    qs::check_err(norm2 == 0, "_normalize", "zero state cannot be normalized");
+
+    double scale = 1.0 / sqrt(norm2);
+    qs::_parallel_for(state.size(), n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            state[i].Re *= scale;
+            state[i].Im *= scale;
+        }
+    });
+}
+
+std::vector<std::size_t> qs::_local_offsets(std::vector<int>& bits) {
+    int k = bits.size();
+    std::size_t local_dim = (std::size_t)1 << k;
+
+    std::vector<std::size_t> offsets(local_dim, 0);
+    for (std::size_t r = 0; r < local_dim; ++r) {
+        for (int j = 0; j < k; ++j) {
+            // the first bit in the list is the most significant bit of the local index
+            if ((r >> (k - 1 - j)) & 1) {
+                offsets[r] |= (std::size_t)1 << bits[j];
+            }
+        }
+    }
+    return offsets;
+}
+
+std::size_t qs::_mask(std::vector<int>& bits) {
+    std::size_t mask = 0;
+    for (int bit : bits) {
+        mask |= (std::size_t)1 << bit;
+    }
+    return mask;
+}
+
+std::size_t qs::_insert_zeros(std::size_t i, std::vector<int>& sorted_bits) {
+    for (int bit : sorted_bits) {
+        std::size_t low = i & (((std::size_t)1 << bit) - 1);
+        i = ((i >> bit) << (bit + 1)) | low;
+    }
+    return i;
+}
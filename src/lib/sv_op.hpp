@@ -0,0 +1,73 @@
+#ifndef __SV_OP_HPP__
+#define __SV_OP_HPP__
+
+#include <cstddef>
+#include <vector>
+
+#include "../utils/err.hpp"
+#include "../utils/parallel.hpp"
+#include "./complex.hpp"
+#include "./vec_op.hpp"
+
+// in-place operations on a state vector of n qubits with 2^n amplitudes
+// qubits are addressed by their bit position in the amplitude index (0 is the least significant bit)
+// every operation splits the work among n_threads threads, the results do not depend on the number of threads
+namespace qs {
+
+    // apply 2x2 matrix m to the qubit at bit position bit
+    void _apply_1q(c_vec& state, c_mat& m, int bit, int n_threads = 1);
+
+    // apply 2x2 matrix m to the qubit at bit position bit only where all control bits are set
+    void _apply_c1q(c_vec& state, c_mat& m, int bit, std::vector<int>& controls, int n_threads = 1);
+
+    // apply 2^k x 2^k matrix m to the k qubits at bit positions bits only where all control bits are set
+    // bits[0] corresponds to the most significant bit of the row/column index of m
+    void _apply_kq(c_vec& state, c_mat& m, std::vector<int>& bits, std::vector<int>& controls, int n_threads = 1);
+
+    // multiply the amplitudes by the diagonal diag of a matrix acting on the qubits at bit positions bits
+    // only where all control bits are set, bits[0] corresponds to the most significant bit of the index of diag
+    void _apply_diagonal(c_vec& state, c_vec& diag, std::vector<int>& bits, std::vector<int>& controls, int n_threads = 1);
+
+    // move the amplitude of local basis state c to local basis state perm[c] multiplied by phases[c]
+    // on the qubits at bit positions bits only where all control bits are set
+    void _apply_permutation(c_vec& state, std::vector<std::size_t>& perm, c_vec& phases, std::vector<int>& bits, std::vector<int>& controls, int n_threads = 1);
+
+    // apply reversible classical function |x>|y> -> |x>|y xor f(x)> given by the table f(x) = table[x]
+    // x is read from the qubits at bit positions input_bits and y from output_bits, the first ones are the most significant
+    void _apply_function(c_vec& state, std::vector<std::size_t>& table, std::vector<int>& input_bits, std::vector<int>& output_bits, int n_threads = 1);
+
+    // compute marginal probability distribution over the qubits at bit positions bits in a single pass
+    // bits[0] corresponds to the most significant bit of the index of the resulting distribution
+    std::vector<double> _probabilities(c_vec& state, std::vector<int>& bits, int n_threads = 1);
+
+    // project the qubit at bit position bit onto |outcome> measured with probability p and renormalize the state
+    // the qubit is left in |target>, which is the outcome for a measurement and |0> for a reset
+    void _collapse(c_vec& state, int bit, int outcome, int target, double p, int n_threads = 1);
+
+    // compute <psi| X^x Z^z |psi> for every z in z_masks, where X^x flips the bits of x_mask
+    // and Z^z negates the amplitudes whose bits of z have odd parity
+    // products of the amplitudes paired by the flip are computed once for all z masks
+    c_vec _pauli_expectations(c_vec& state, std::size_t x_mask, std::vector<std::size_t>& z_masks, int n_threads = 1);
+
+    // add coefficient * X^x Z^z |psi> to out, i.e. out[k ^ x] += coefficient * (-1)^(k & z) * state[k]
+    void _add_pauli(c_vec& state, c_vec& out, std::size_t x_mask, std::size_t z_mask, Complex coefficient, int n_threads = 1);
+
+    // compute real part of the inner product <a|b>
+    double _real_overlap(c_vec& a, c_vec& b, int n_threads = 1);
+
+    // compute squared norm of the state
+    double _norm2(c_vec& state, int n_threads = 1);
+    // scale the state to unit norm
+    void _normalize(c_vec& state, int n_threads = 1);
+
+    // compute offsets of all 2^k local basis states of the qubits at bit positions bits
+    std::vector<std::size_t> _local_offsets(std::vector<int>& bits);
+
+    // compute mask with the given bit positions set
+    std::size_t _mask(std::vector<int>& bits);
+
+    // insert zero bits at the sorted bit positions into index i
+    std::size_t _insert_zeros(std::size_t i, std::vector<int>& sorted_bits);
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "./svd.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+// one-sided Jacobi on the columns of m x n matrix w (m >= n) stored column by column
+// w is replaced by u * diag(s) and v (n x n, column by column) accumulates the rotations
+static void jacobi(qs::c_vec& w, int m, int n, qs::c_vec& v) {
+    const double eps = 1e-15;
+    const int max_sweeps = 100;
+
+    v = qs::c_vec(n * n);
+    for (int j = 0; j < n; ++j) {
+        v[j * n + j] = qs::Complex(1);
+    }
+
+    for (int sweep = 0; sweep < max_sweeps; ++sweep) {
+        bool rotated = false;
+        for (int i = 0; i < n - 1; ++i) {
+            for (int j = i + 1; j < n; ++j) {
+                qs::Complex* wi = &w[i * m];
+                qs::Complex* wj = &w[j * m];
+
+                double alpha = 0;
+                double beta = 0;
+                double g_re = 0;
+                double g_im = 0;
+                for (int k = 0; k < m; ++k) {
+                    alpha += wi[k].Re * wi[k].Re + wi[k].Im * wi[k].Im;
+                    beta += wj[k].Re * wj[k].Re + wj[k].Im * wj[k].Im;
+                    // gamma = w_i^H w_j
+                    g_re += wi[k].Re * wj[k].Re + wi[k].Im * wj[k].Im;
+                    g_im += wi[k].Re * wj[k].Im - wi[k].Im * wj[k].Re;
+                }
+                double g = sqrt(g_re * g_re + g_im * g_im);
+                if (g <= eps * sqrt(alpha * beta) || g == 0) {
+                    continue;
+                }
+                rotated = true;
+
+                // real rotation of w_i and e^{-i phi} w_j which makes them orthogonal, phi is the phase of gamma
+                double zeta = (beta - alpha) / (2 * g);
+                double t = (zeta >= 0 ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1 + zeta * zeta));
+                double c = 1 / sqrt(1 + t * t);
+                double s = c * t;
+                double p_re = g_re / g;
+                double p_im = g_im / g;
+
+                // w_i' = c w_i - s e^{-i phi} w_j, w_j' = s e^{i phi} w_i + c w_j
+                auto rotate = [&](qs::Complex* x, qs::Complex* y, int size) {
+                    for (int k = 0; k < size; ++k) {
+                        qs::Complex xi = x[k];
+                        qs::Complex yj = y[k];
+                        x[k].Re = c * xi.Re - s * (p_re * yj.Re + p_im * yj.Im);
+                        x[k].Im = c * xi.Im - s * (p_re * yj.Im - p_im * yj.Re);
+                        y[k].Re = s * (p_re * xi.Re - p_im * xi.Im) + c * yj.Re;
+                        y[k].Im = s * (p_re * xi.Im + p_im * xi.Re) + c * yj.Im;
+                    }
+                };
+                rotate(wi, wj, m);
+                rotate(&v[i * n], &v[j * n], n);
+            }
+        }
+        if (!rotated) {
+            return;
+        }
+    }
+}
+
+void qs::_svd(qs::c_vec& a, int m, int n, qs::c_vec& u, std::vector<double>& s, qs::c_vec& vh) {
+    qs::check_err(m < 1 || n < 1, "_svd", "empty matrix");
+    qs::check_dims("_svd", a.size(), m * n);
+
+    // decompose a^H for wide matrices so that the columns are never longer than needed
+    bool wide = m < n;
+    int rows = wide ? n : m;
+    int cols = wide ? m : n;
+
+    // columns of the decomposed matrix
+    qs::c_vec w(rows * cols);
+    for (int r = 0; r < m; ++r) {
+        for (int c = 0; c < n; ++c) {
+            if (wide) {
+                w[r * n + c] = qs::Complex(a[r * n + c].Re, -a[r * n + c].Im);
+            } else {
+                w[c * m + r] = a[r * n + c];
+            }
+        }
+    }
+
+    qs::c_vec v;
+    jacobi(w, rows, cols, v);
+
+    // singular values are the norms of the orthogonalized columns
+    std::vector<double> norms(cols);
+    for (int j = 0; j < cols; ++j) {
+        double sum = 0;
+        for (int k = 0; k < rows; ++k) {
+            sum += w[j * rows + k].Re * w[j * rows + k].Re + w[j * rows + k].Im * w[j * rows + k].Im;
+        }
+        norms[j] = sqrt(sum);
+    }
+    std::vector<int> order(cols);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int i, int j) { return norms[i] > norms[j]; });
+
+    // left vectors of the decomposed matrix are the normalized columns, right ones are columns of v
+    int r = cols;
+    s = std::vector<double>(r);
+    qs::c_vec left(rows * r);
+    qs::c_vec right(cols * r);
+    for (int k = 0; k < r; ++k) {
+        int j = order[k];
+        s[k] = norms[j];
+        double scale = norms[j] > 0 ? 1 / norms[j] : 0;
+        for (int i = 0; i < rows; ++i) {
+            left[i * r + k] = w[j * rows + i] * qs::Complex(scale);
+        }
+        for (int i = 0; i < cols; ++i) {
+            right[i * r + k] = v[j * cols + i];
+        }
+    }
+
+    // a = left s right^H, or a^H = left s right^H for wide matrices, i.e. a = right s left^H
+    qs::c_vec& us = wide ? right : left;
+    qs::c_vec& vs = wide ? left : right;
+    u = us;
+    vh = qs::c_vec(r * n);
+    for (int k = 0; k < r; ++k) {
+        for (int c = 0; c < n; ++c) {
+            vh[k * n + c] = qs::Complex(vs[c * r + k].Re, -vs[c * r + k].Im);
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef __SVD_HPP__
+#define __SVD_HPP__
+
+#include <vector>
+
+#include "../utils/err.hpp"
+#include "./complex.hpp"
+#include "./vec_op.hpp"
+
+namespace qs {
+
+    // singular value decomposition a = u * diag(s) * vh of a general m x n complex matrix stored row by row
+    // computed by one-sided Jacobi rotations, singular values are sorted in decreasing order
+    // u is m x r and vh is r x n (both row by row) with r = min(m, n)
+    void _svd(c_vec& a, int m, int n, c_vec& u, std::vector<double>& s, c_vec& vh);
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "./tableau.hpp"
+
+qs::Tableau::Tableau(int n) {
+    qs::check_err(n < 1, "Tableau", "at least one qubit is required");
+
+    this->n = n;
+    this->words = (n + 63) / 64;
+    this->xs = std::vector<std::uint64_t>((2 * n + 1) * this->words, 0);
+    this->zs = std::vector<std::uint64_t>((2 * n + 1) * this->words, 0);
+    this->rs = std::vector<std::uint8_t>(2 * n + 1, 0);
+
+    // destabilizers X_q and stabilizers Z_q of |0...0>
+    for (int q = 0; q < n; ++q) {
+        this->xs[q * this->words + q / 64] |= (std::uint64_t)1 << (q % 64);
+        this->zs[(n + q) * this->words + q / 64] |= (std::uint64_t)1 << (q % 64);
+    }
+}
+
+int qs::Tableau::size() {
+    return this->n;
+}
+
+bool qs::Tableau::x_bit(int row, int q) {
+    return (this->xs[row * this->words + q / 64] >> (q % 64)) & 1;
+}
+
+bool qs::Tableau::z_bit(int row, int q) {
+    return (this->zs[row * this->words + q / 64] >> (q % 64)) & 1;
+}
+
+void qs::Tableau::rowsum(int h, int i) {
+    std::uint64_t *x1 = &this->xs[i * this->words];
+    std::uint64_t *z1 = &this->zs[i * this->words];
+    std::uint64_t *x2 = &this->xs[h * this->words];
+    std::uint64_t *z2 = &this->zs[h * this->words];
+
+    // exponent of i picked up by multiplying the Pauli operators qubit by qubit, counted 64 qubits at a time
+    int sum = 2 * this->rs[h] + 2 * this->rs[i];
+    for (int w = 0; w < this->words; ++w) {
+        std::uint64_t y = x1[w] & z1[w];
+        std::uint64_t x = x1[w] & ~z1[w];
+        std::uint64_t z = ~x1[w] & z1[w];
+        std::uint64_t plus = (y & ~x2[w] & z2[w]) | (x & x2[w] & z2[w]) | (z & x2[w] & ~z2[w]);
+        std::uint64_t minus = (y & x2[w] & ~z2[w]) | (x & ~x2[w] & z2[w]) | (z & x2[w] & z2[w]);
+        sum += __builtin_popcountll(plus) - __builtin_popcountll(minus);
+        x2[w] ^= x1[w];
+        z2[w] ^= z1[w];
+    }
+    this->rs[h] = ((sum % 4) + 4) % 4 == 2 ? 1 : 0;
+}
+
+void qs::Tableau::copy_row(int dst, int src) {
+    for (int w = 0; w < this->words; ++w) {
+        this->xs[dst * this->words + w] = this->xs[src * this->words + w];
+        this->zs[dst * this->words + w] = this->zs[src * this->words + w];
+    }
+    this->rs[dst] = this->rs[src];
+}
+
+void qs::Tableau::clear_row(int row) {
+    for (int w = 0; w < this->words; ++w) {
+        this->xs[row * this->words + w] = 0;
+        this->zs[row * this->words + w] = 0;
+    }
+    this->rs[row] = 0;
+}
+
+void qs::Tableau::h(int q) {
+    int w = q / 64;
+    std::uint64_t m = (std::uint64_t)1 << (q % 64);
+    for (int row = 0; row < 2 * this->n; ++row) {
+        std::uint64_t &x = this->xs[row * this->words + w];
+        std::uint64_t &z = this->zs[row * this->words + w];
+        this->rs[row] ^= (x & z & m) != 0;
+        // swap x and z bits of the qubit
+        if (((x ^ z) & m) != 0) {
+            x ^= m;
+            z ^= m;
+        }
+    }
+}
+
+void qs::Tableau::s(int q) {
+    int w = q / 64;
+    std::uint64_t m = (std::uint64_t)1 << (q % 64);
+    for (int row = 0; row < 2 * this->n; ++row) {
+        std::uint64_t &x = this->xs[row * this->words + w];
+        std::uint64_t &z = this->zs[row * this->words + w];
+        this->rs[row] ^= (x & z & m) != 0;
+        z ^= x & m;
+    }
+}
+
+void qs::Tableau::x(int q) {
+    // rows with Z or Y on the qubit anticommute with X and change sign
+    for (int row = 0; row < 2 * this->n; ++row) {
+        this->rs[row] ^= this->z_bit(row, q);
+    }
+}
+
+void qs::Tableau::y(int q) {
+    for (int row = 0; row < 2 * this->n; ++row) {
+        this->rs[row] ^= this->x_bit(row, q) ^ this->z_bit(row, q);
+    }
+}
+
+void qs::Tableau::z(int q) {
+    for (int row = 0; row < 2 * this->n; ++row) {
+        this->rs[row] ^= this->x_bit(row, q);
+    }
+}
+
+void qs::Tableau::cx(int control, int target) {
+    int wc = control / 64;
+    int wt = target / 64;
+    int bc = control % 64;
+    int bt = target % 64;
+    for (int row = 0; row < 2 * this->n; ++row) {
+        std::uint64_t *x = &this->xs[row * this->words];
+        std::uint64_t *z = &this->zs[row * this->words];
+        int xc = (x[wc] >> bc) & 1;
+        int zc = (z[wc] >> bc) & 1;
+        int xt = (x[wt] >> bt) & 1;
+        int zt = (z[wt] >> bt) & 1;
+        this->rs[row] ^= xc & zt & (xt ^ zc ^ 1);
+        x[wt] ^= (std::uint64_t)xc << bt;
+        z[wc] ^= (std::uint64_t)zt << bc;
+    }
+}
+
+void qs::Tableau::apply(qs::TableauOp &op) {
+    switch (op.gate) {
+        case 'h':
+            this->h(op.a);
+            break;
+        case 's':
+            this->s(op.a);
+            break;
+        case 'x':
+            this->x(op.a);
+            break;
+        case 'y':
+            this->y(op.a);
+            break;
+        case 'z':
+            this->z(op.a);
+            break;
+        case 'c':
+            this->cx(op.a, op.b);
+            break;
+        default:
+            qs::check_err(true, "Tableau::apply", std::string("unknown operation ") + op.gate);
+    }
+}
+
+bool qs::Tableau::is_deterministic(int q) {
+    // outcome is random if some stabilizer anticommutes with Z_q
+    for (int row = this->n; row < 2 * this->n; ++row) {
+        if (this->x_bit(row, q)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int qs::Tableau::measure(int q, std::mt19937 &rng) {
+    qs::check_range("Tableau::measure", q, this->n);
+
+    int p = -1;
+    for (int row = this->n; row < 2 * this->n; ++row) {
+        if (this->x_bit(row, q)) {
+            p = row;
+            break;
+        }
+    }
+
+    // random outcome, stabilizer p is replaced by +-Z_q and the other rows are made to commute with it
+    if (p != -1) {
+        for (int row = 0; row < 2 * this->n; ++row) {
+            if (row != p && this->x_bit(row, q)) {
+                this->rowsum(row, p);
+            }
+        }
+        this->copy_row(p - this->n, p);
+        this->clear_row(p);
+        this->zs[p * this->words + q / 64] |= (std::uint64_t)1 << (q % 64);
+        this->rs[p] = std::uniform_int_distribution<int>(0, 1)(rng);
+        return this->rs[p];
+    }
+
+    // deterministic outcome is the sign of Z_q written as a product of stabilizers
+    int scratch = 2 * this->n;
+    this->clear_row(scratch);
+    for (int row = 0; row < this->n; ++row) {
+        if (this->x_bit(row, q)) {
+            this->rowsum(scratch, row + this->n);
+        }
+    }
+    return this->rs[scratch];
+}
+
+int qs::Tableau::expectation(std::string &paulis) {
+    qs::check_dims("Tableau::expectation", paulis.size(), this->n);
+
+    std::vector<std::uint64_t> px(this->words, 0);
+    std::vector<std::uint64_t> pz(this->words, 0);
+    for (int q = 0; q < this->n; ++q) {
+        std::uint64_t m = (std::uint64_t)1 << (q % 64);
+        if (paulis[q] == 'X' || paulis[q] == 'Y') {
+            px[q / 64] |= m;
+        }
+        if (paulis[q] == 'Z' || paulis[q] == 'Y') {
+            pz[q / 64] |= m;
+        }
+    }
+    // rows anticommute with the string if they differ from it on an odd number of qubits
+    auto anticommutes = [&](int row) {
+        int parity = 0;
+        for (int w = 0; w < this->words; ++w) {
+            parity ^= __builtin_popcountll((this->xs[row * this->words + w] & pz[w]) ^ (this->zs[row * this->words + w] & px[w])) & 1;
+        }
+        return parity == 1;
+    };
+
+    // string anticommuting with a stabilizer has zero expectation
+    for (int row = this->n; row < 2 * this->n; ++row) {
+        if (anticommutes(row)) {
+            return 0;
+        }
+    }
+
+    // otherwise it is a product of the stabilizers paired with the destabilizers it anticommutes with, up to the sign
+    int scratch = 2 * this->n;
+    this->clear_row(scratch);
+    for (int row = 0; row < this->n; ++row) {
+        if (anticommutes(row)) {
+            this->rowsum(scratch, row + this->n);
+        }
+    }
+    return this->rs[scratch] ? -1 : 1;
+}
+
+std::vector<std::string> qs::Tableau::stabilizers() {
+    std::vector<std::string> generators;
+    for (int row = this->n; row < 2 * this->n; ++row) {
+        std::string pauli = this->rs[row] ? "-" : "+";
+        for (int q = 0; q < this->n; ++q) {
+            bool x = this->x_bit(row, q);
+            bool z = this->z_bit(row, q);
+            pauli += x ? (z ? 'Y' : 'X') : (z ? 'Z' : 'I');
+        }
+        generators.push_back(pauli);
+    }
+    return generators;
+}
@@ -0,0 +1,66 @@
+#ifndef __TABLEAU_HPP__
+#define __TABLEAU_HPP__
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../utils/err.hpp"
+
+namespace qs {
+
+    // elementary clifford operation on the tableau
+    // gate is one of 'h', 's', 'x', 'y', 'z' acting on qubit a or 'c' for CNOT with control a and target b
+    struct TableauOp {
+        char gate;
+        int a;
+        int b;
+    };
+
+    // Aaronson-Gottesman tableau of a stabilizer state of n qubits
+    // rows 0, ..., n - 1 are destabilizers, rows n, ..., 2n - 1 are stabilizers and row 2n is a scratch row
+    // x and z bits of every row are packed into 64-bit words, qubit q is bit q % 64 of word q / 64
+    class Tableau {
+    private:
+        int n;
+        int words;
+        std::vector<std::uint64_t> xs;
+        std::vector<std::uint64_t> zs;
+        // sign of every row, 1 means -1
+        std::vector<std::uint8_t> rs;
+
+        bool x_bit(int row, int q);
+        bool z_bit(int row, int q);
+        // multiply row h by row i and keep the sign of the product
+        void rowsum(int h, int i);
+        void copy_row(int dst, int src);
+        void clear_row(int row);
+
+    public:
+        // tableau of state |0...0>
+        Tableau(int n);
+
+        int size();
+
+        void h(int q);
+        void s(int q);
+        void x(int q);
+        void y(int q);
+        void z(int q);
+        void cx(int control, int target);
+        void apply(TableauOp &op);
+
+        // check if measurement of qubit q has a deterministic outcome
+        bool is_deterministic(int q);
+        // measure qubit q in the computational basis, collapse the state and return the outcome
+        int measure(int q, std::mt19937 &rng);
+        // expectation value of a Pauli string with a letter I, X, Y or Z for every qubit, which is 0, 1 or -1
+        int expectation(std::string &paulis);
+
+        // stabilizer generators as signed Pauli strings, i.e. +XX, -ZZ
+        std::vector<std::string> stabilizers();
+    };
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "vec_op.hpp"
 
+#include <algorithm>
+
 qs::c_vec qs::_add(qs::c_vec& a, qs::c_vec& b) {
     qs::check_dims("_add [vector]", a.size(), b.size());
 
@@ -43,43 +45,45 @@ qs::c_vec qs::_conjugate(qs::c_vec& a) {
 qs::c_mat qs::_add(qs::c_mat& a, qs::c_mat& b) {
     qs::check_dims("_add [matrix]", a.size(), b.size());
 
-    int dim = a.size();
+    std::size_t n = a.size() * a.size();
+    Complex* pb = b.data();
 
     qs::c_mat res(a);
-    for (int i = 0; i < dim; ++i)
-        for (int j = 0; j < dim; ++j)
-            res[i][j] += b[i][j];
+    Complex* pr = res.data();
+    for (std::size_t i = 0; i < n; ++i)
+        pr[i] += pb[i];
     return res;
 }
 
 qs::c_mat qs::_sub(qs::c_mat& a, qs::c_mat& b) {
     qs::check_dims("_sub [matrix]", a.size(), b.size());
 
-    int dim = a.size();
+    std::size_t n = a.size() * a.size();
+    Complex* pb = b.data();
 
     qs::c_mat res(a);
-    for (int i = 0; i < dim; ++i)
-        for (int j = 0; j < dim; ++j)
-            res[i][j] -= b[i][j];
+    Complex* pr = res.data();
+    for (std::size_t i = 0; i < n; ++i)
+        pr[i] -= pb[i];
     return res;
 }
 
 qs::c_mat qs::_mul(qs::Complex& c, qs::c_mat& a) {
-    int dim = a.size();
+    std::size_t n = a.size() * a.size();
 
     qs::c_mat res(a);
-    for (int i = 0; i < dim; ++i)
-        for (int j = 0; j < dim; ++j)
-            res[i][j] *= c;
+    Complex* pr = res.data();
+    for (std::size_t i = 0; i < n; ++i)
+        pr[i] *= c;
     return res;
 }
 
 qs::c_mat qs::_dagger(qs::c_mat& a) {
-    int dim = a.size();
+    std::size_t dim = a.size();
 
-    qs::c_mat res(dim, qs::c_vec(dim));
-    for (int i = 0; i < dim; ++i)
-        for (int j = 0; j < dim; ++j)
+    qs::c_mat res(dim);
+    for (std::size_t i = 0; i < dim; ++i)
+        for (std::size_t j = 0; j < dim; ++j)
             res[i][j] = a[j][i].conjugate();
     return res;
 }
@@ -87,13 +91,10 @@ qs::c_mat qs::_dagger(qs::c_mat& a) {
 qs::c_vec qs::_matvecmul(qs::c_mat& m, qs::c_vec& x) {
     qs::check_dims("_matvecmul", m.size(), x.size());
 
-    int dim = m.size();
+    std::size_t dim = m.size();
     qs::c_vec res(dim);
-    for (int i = 0; i < dim; ++i) {
-        for (int j = 0; j < dim; ++j) {
-            qs::Complex term = x[j] * m[i][j];
-            res[i] += term;
-        }
+    for (std::size_t i = 0; i < dim; ++i) {
+        res[i] = qs::_cdot(dim, m[i], x.data());
     }
     return res;
 }
@@ -101,98 +102,117 @@ qs::c_vec qs::_matvecmul(qs::c_mat& m, qs::c_vec& x) {
 qs::c_vec qs::_vecmatmul(qs::c_vec& x, qs::c_mat& m) {
     qs::check_dims("_vecmatmul", m.size(), x.size());
 
-    int dim = m.size();
+    std::size_t dim = m.size();
     qs::c_vec res(dim);
-    for (int i = 0; i < dim; ++i) {
-        for (int j = 0; j < dim; ++j) {
-            qs::Complex term = x[j] * m[j][i];
-            res[i] += term;
-        }
+    // accumulate scaled rows to walk the matrix in memory order
+    for (std::size_t j = 0; j < dim; ++j) {
+        qs::_caxpy(dim, x[j], m[j], res.data());
     }
     return res;
 }
 
+// tile of 64 x 64 complex numbers of the right operand fits into the L2 cache
+static std::size_t matmul_block = 64;
+static int matmul_threads = qs::_hardware_threads();
+
+void qs::_set_matmul_block(std::size_t block) {
+    qs::check_err(block == 0, "_set_matmul_block", "block size must be positive");
+    matmul_block = block;
+}
+
+void qs::_set_matmul_threads(int threads) {
+    qs::check_err(threads <= 0, "_set_matmul_threads", "number of threads must be positive");
+    matmul_threads = threads;
+}
+
 qs::c_mat qs::_matmul(qs::c_mat& a, qs::c_mat& b) {
     qs::check_dims("_matmul", a.size(), b.size());
 
-    int dim = a.size();
-    qs::c_mat res(dim, qs::c_vec(dim));
-    for (int r = 0; r < dim; ++r) {
-        for (int c = 0; c < dim; ++c) {
-            for (int i = 0; i < dim; ++i) {
-                qs::Complex term = a[r][i] * b[i][c];
-                res[r][c] += term;
+    std::size_t dim = a.size();
+    std::size_t block = std::min(matmul_block, dim);
+    qs::c_mat res(dim);
+
+    // every task computes one block of rows, walking tiles of b so that a tile is reused by all rows of the block
+    std::size_t n_row_blocks = (dim + block - 1) / block;
+    qs::ThreadPool::instance().run(n_row_blocks, matmul_threads, [&](int rb) {
+        std::size_t r_begin = rb * block;
+        std::size_t r_end = std::min(dim, r_begin + block);
+        for (std::size_t i_begin = 0; i_begin < dim; i_begin += block) {
+            std::size_t i_end = std::min(dim, i_begin + block);
+            for (std::size_t c_begin = 0; c_begin < dim; c_begin += block) {
+                std::size_t width = std::min(dim, c_begin + block) - c_begin;
+                for (std::size_t r = r_begin; r < r_end; ++r) {
+                    Complex* res_row = res[r] + c_begin;
+                    Complex* a_row = a[r];
+                    for (std::size_t i = i_begin; i < i_end; ++i) {
+                        // gate matrices are mostly zeros
+                        if (a_row[i].Re != 0 || a_row[i].Im != 0) {
+                            qs::_caxpy(width, a_row[i], b[i] + c_begin, res_row);
+                        }
+                    }
+                }
             }
         }
-    }
+    });
+
     return res;
 }
 
 qs::Complex qs::_inner(c_vec& a, c_vec& b) {
     qs::check_dims("_inner", a.size(), b.size());
 
-    int dim = a.size();
-    qs::Complex res;
-    for (int i = 0; i < dim; ++i) {
-        qs::Complex term = a[i] * b[i];
-        res += term;
-    }
-    return res;
+    return qs::_cdot(a.size(), a.data(), b.data());
 }
 
 qs::c_mat qs::_outer(c_vec& a, c_vec& b) {
     qs::check_dims("_outer", a.size(), b.size());
 
-    int dim = a.size();
-    qs::c_mat res(dim, qs::c_vec(dim));
-    for (int i = 0; i < dim; ++i) {
-        for (int j = 0; j < dim; ++j) {
-            res[i][j] = a[i] * b[j];
-        }
+    std::size_t dim = a.size();
+    qs::c_mat res(dim);
+    for (std::size_t i = 0; i < dim; ++i) {
+        qs::_cscale(dim, a[i], b.data(), res[i]);
     }
     return res;
 }
 
 qs::c_vec qs::_tensor(c_vec& a, c_vec& b) {
-    int dim_a = a.size();
-    int dim_b = b.size();
+    std::size_t dim_a = a.size();
+    std::size_t dim_b = b.size();
 
     qs::c_vec res(dim_a * dim_b);
-    int idx = 0;
-    for (int i = 0; i < dim_a; ++i) {
-        for (int j = 0; j < dim_b; ++j) {
-            res[idx++] = a[i] * b[j];
-        }
+    for (std::size_t i = 0; i < dim_a; ++i) {
+        qs::_cscale(dim_b, a[i], b.data(), res.data() + i * dim_b);
     }
     return res;
 }
 
 qs::c_mat qs::_tensor(c_mat& a, c_mat& b) {
-    int dim_a = a.size();
-    int dim_b = b.size();
-    int dim = dim_a * dim_b;
-
-    qs::c_mat res(dim, qs::c_vec(dim));
-    int row_offset;
-    int col_offset;
-    int row;
-    int col;
-    for (int r1 = 0; r1 < dim_a; ++r1) {
-        row_offset = r1 * dim_b;
-        for (int c1 = 0; c1 < dim_a; ++c1) {
-            col_offset = c1 * dim_b;
-            for (int r2 = 0; r2 < dim_b; ++r2) {
-                row = row_offset + r2;
-                for (int c2 = 0; c2 < dim_b; ++c2) {
-                    col = col_offset + c2;
-                    res[row][col] = a[r1][c1] * b[r2][c2];
-                }
+    std::size_t dim_a = a.size();
+    std::size_t dim_b = b.size();
+    std::size_t dim = dim_a * dim_b;
+
+    qs::c_mat res(dim);
+    // every row of the result is a concatenation of scaled rows of b
+    for (std::size_t r1 = 0; r1 < dim_a; ++r1) {
+        for (std::size_t r2 = 0; r2 < dim_b; ++r2) {
+            Complex* row = res[r1 * dim_b + r2];
+            for (std::size_t c1 = 0; c1 < dim_a; ++c1) {
+                qs::_cscale(dim_b, a[r1][c1], b[r2], row + c1 * dim_b);
             }
         }
     }
     return res;
 }
 
+qs::c_mat::c_mat(std::initializer_list<std::initializer_list<Complex>> rows) {
+    this->dim = rows.size();
+    this->values.reserve(this->dim * this->dim);
+    for (const std::initializer_list<Complex>& row : rows) {
+        qs::check_dims("c_mat", row.size(), this->dim);
+        this->values.insert(this->values.end(), row.begin(), row.end());
+    }
+}
+
 void qs::print_vec(c_vec& a, bool transpose) {
     std::cout << "[";
     for (int i = 0; i < a.size(); ++i) {
@@ -1,19 +1,47 @@
 #ifndef __VEC_OP_HPP__
 #define __VEC_OP_HPP__
 
+#include <cstddef>
+#include <initializer_list>
 #include <iomanip>
 #include <iostream>
 #include <vector>
 
 #include "../utils/err.hpp"
+#include "../utils/parallel.hpp"
+#include "./aligned.hpp"
 #include "./complex.hpp"
+#include "./simd.hpp"
 
 // NOTE: consider only square matrices as quantum linear operators are square in our case
 namespace qs {
 
-    // shorthand types for complex vector and matrix
-    typedef std::vector<Complex> c_vec;
-    typedef std::vector<std::vector<Complex>> c_mat;
+    // shorthand type for aligned complex vectors
+    typedef std::vector<Complex, AlignedAllocator<Complex>> c_vec;
+
+    // square complex matrix stored row by row in one contiguous aligned buffer
+    // m[r][c] addresses the element in row r and column c
+    class c_mat {
+    private:
+        std::size_t dim;
+        c_vec values;
+
+    public:
+        c_mat() : dim(0){};
+        // zero matrix of dimension dim x dim
+        c_mat(std::size_t dim) : dim(dim), values(dim * dim){};
+        // matrix given by its rows, i.e. {{a, b}, {c, d}}
+        c_mat(std::initializer_list<std::initializer_list<Complex>> rows);
+
+        std::size_t size() const { return this->dim; }
+
+        Complex *operator[](std::size_t r) { return this->values.data() + r * this->dim; }
+        const Complex *operator[](std::size_t r) const { return this->values.data() + r * this->dim; }
+
+        // all dim * dim elements in row-major order
+        c_vec &flat() { return this->values; }
+        Complex *data() { return this->values.data(); }
+    };
 
     // basic operations on complex vectors
     c_vec _add(c_vec& a, c_vec& b);
@@ -34,7 +62,11 @@ namespace qs {
     // compute x^TM in complex numbers
     c_vec _vecmatmul(c_vec& m, c_mat& x);
     // compute AB in complex numbers
+    // rows of the result are split among threads and the product is computed in block x block tiles
     c_mat _matmul(c_mat& a, c_mat& b);
+    // tune the tiled matrix multiplication, block is the size of a square tile in elements
+    void _set_matmul_block(std::size_t block);
+    void _set_matmul_threads(int threads);
 
     // compute inner product of two complex vectors a^Tb
     Complex _inner(c_vec& a, c_vec& b);
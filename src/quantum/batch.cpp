@@ -0,0 +1,93 @@
+#include "./batch.hpp"
+
+qs::Batch::Batch(qs::QuantumCircuit base) : base(base) {
+    this->n_threads = qs::_hardware_threads();
+}
+
+void qs::Batch::add(qs::Variant variant) {
+    this->variants.push_back(variant);
+}
+
+int qs::Batch::size() {
+    return this->variants.size();
+}
+
+void qs::Batch::set_threads(int n_threads) {
+    qs::check_err(n_threads < 1, "set_threads", "number of threads must be positive");
+    this->n_threads = n_threads;
+}
+
+static bool same_state(qs::c_vec &a, qs::c_vec &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a[i].Re != b[i].Re || a[i].Im != b[i].Im) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<qs::Results> qs::Batch::run(int shots) {
+    // only unitary and function gates give the same state in every variant, noise and measurements differ between shots
+    // and parameterized gates may be bound to different values by the variants
+    // matrix product states and density matrices do not start from a state vector, so their variants are simulated from scratch
+    bool shared = !this->base.gates.empty() && this->base.gate_channels.empty();
+    shared = shared && this->base.backend != qs::Backend::MPS && this->base.backend != qs::Backend::DENSITY_MATRIX;
+    for (qs::Gate &gate : this->base.gates) {
+        shared = shared && !gate.is_dynamic() && gate.type != qs::GateType::CHANNEL && !gate.is_parametric();
+    }
+
+    // a clifford template is likely to give clifford variants, which are faster on the tableau than from a shared state vector
+    if (shared && (this->base.backend == qs::Backend::AUTOMATIC || this->base.backend == qs::Backend::STABILIZER)) {
+        bool clifford = this->base.start_state.empty();
+        std::vector<qs::TableauOp> ops;
+        for (int q = 0; q < this->base.n_qubits && clifford; ++q) {
+            clifford = qs::clifford_prepare(this->base.qubits[q], q, ops);
+        }
+        for (int i = 0; i < this->base.gates.size() && clifford; ++i) {
+            clifford = qs::clifford_ops(this->base.gates[i], ops);
+        }
+        shared = !clifford;
+    }
+
+    // the template gates are fused and applied once by all threads
+    qs::Ket prefix;
+    if (shared) {
+        prefix = this->base.initial_state();
+        std::vector<qs::Gate> gates = qs::fuse_gates(this->base.gates, this->base.fusion_size);
+        for (qs::Gate &gate : gates) {
+            gate.classify();
+            gate.apply(prefix.items, this->base.n_qubits, this->n_threads);
+        }
+    }
+
+    std::vector<qs::Results> results(this->variants.size(), qs::Results(shots, this->base.n_bits));
+    qs::_parallel_for(this->variants.size(), this->n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            qs::QuantumCircuit circuit = this->base;
+            if (shared) {
+                circuit.gates.clear();
+                circuit.set_state(prefix);
+            }
+            this->variants[i](circuit);
+            // variant which prepares its own initial state needs the template gates applied to it, as without the shared state
+            // and so does a variant on a backend which cannot start from a state vector or with noise on every gate,
+            // which starts again from the initial state of the template
+            bool own_state = shared && !same_state(circuit.start_state, prefix.items);
+            bool other_start = circuit.backend == qs::Backend::MPS || circuit.backend == qs::Backend::STABILIZER || !circuit.gate_channels.empty();
+            if (shared && (own_state || other_start)) {
+                if (!own_state) {
+                    circuit.start_state = this->base.start_state;
+                }
+                circuit.gates.insert(circuit.gates.begin(), this->base.gates.begin(), this->base.gates.end());
+            }
+            circuit.set_threads(1);
+            circuit.compile();
+            results[i] = circuit.run(shots);
+        }
+    }, 1);
+
+    return results;
+}
@@ -0,0 +1,44 @@
+#ifndef __BATCH_HPP__
+#define __BATCH_HPP__
+
+#include <functional>
+#include <vector>
+
+#include "../utils/err.hpp"
+#include "../utils/parallel.hpp"
+#include "./circuit.hpp"
+#include "./clifford.hpp"
+#include "./fusion.hpp"
+
+namespace qs {
+
+    // variant of a template circuit, it adds its own gates and measurements to a copy of the template
+    typedef std::function<void(QuantumCircuit &)> Variant;
+
+    // many variants of a template circuit, i.e. different oracles, run concurrently in one call
+    // the unitary gates of the template are fused and simulated once and every variant compiles only its own gates
+    // on top of the state they produce, unless the template is a clifford circuit whose variants are simulated
+    // by the stabilizer tableau from scratch or the template uses the matrix product state or density matrix backend
+    class Batch {
+    private:
+        QuantumCircuit base;
+        std::vector<Variant> variants;
+        int n_threads;
+
+    public:
+        // the template holds the initial qubits, the classical bits, the settings and the gates shared by all variants
+        Batch(QuantumCircuit base);
+
+        // add variant which inserts its gates after the gates of the template
+        void add(Variant variant);
+        int size();
+
+        // set number of threads among which the variants are distributed, every variant runs on a single thread
+        void set_threads(int n_threads);
+
+        // compile and run every variant with the given number of shots, the results are in the order of the variants
+        std::vector<Results> run(int shots);
+    };
+};
+
+#endif
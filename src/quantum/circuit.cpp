@@ -4,236 +4,1559 @@ qs::QuantumCircuit::QuantumCircuit(std::vector<Ket> &qubits, int n_bits) {
     qs::check_err(qubits.size() != n_bits, "circuit", "vector dimension mismatch");
 
     this->compiled = false;
+    this->bound = false;
 
     this->n_qubits = qubits.size();
     this->qubits = qubits;
 
     this->n_bits = n_bits;
     this->measurement_mapping = std::vector<int>(this->n_qubits, -1);
+    this->n_threads = qs::_hardware_threads();
+    this->fusion_size = qs::default_fusion_size;
+    this->backend = qs::Backend::AUTOMATIC;
+    this->max_bond = qs::default_max_bond;
+    this->mps_cutoff = qs::default_mps_cutoff;
+    this->sparse_density = qs::default_sparse_density;
+    this->n_trajectories = 0;
+    this->max_copies = qs::default_branch_copies;
+    this->condition_value = 0;
+    this->readout_p01 = std::vector<double>(this->n_qubits, 0);
+    this->readout_p10 = std::vector<double>(this->n_qubits, 0);
 }
 
 qs::QuantumCircuit::QuantumCircuit(int n_qubits, int n_bits, BasicQubits basis) {
     this->compiled = false;
+    this->bound = false;
 
     this->n_qubits = n_qubits;
     this->qubits = std::vector<qs::Ket>(n_qubits, qs::Ket(basis));
 
     this->n_bits = n_bits;
     this->measurement_mapping = std::vector<int>(this->n_qubits, -1);
+    this->n_threads = qs::_hardware_threads();
+    this->fusion_size = qs::default_fusion_size;
+    this->backend = qs::Backend::AUTOMATIC;
+    this->max_bond = qs::default_max_bond;
+    this->mps_cutoff = qs::default_mps_cutoff;
+    this->sparse_density = qs::default_sparse_density;
+    this->n_trajectories = 0;
+    this->max_copies = qs::default_branch_copies;
+    this->condition_value = 0;
+    this->readout_p01 = std::vector<double>(this->n_qubits, 0);
+    this->readout_p10 = std::vector<double>(this->n_qubits, 0);
+}
+
+void qs::QuantumCircuit::set_state(qs::Ket state) {
+    qs::check_dims("set_state", state.items.size(), (std::size_t)1 << this->n_qubits);
+    this->start_state = state.items;
+    this->compiled = false;
+}
+
+qs::Ket qs::QuantumCircuit::initial_state() {
+    qs::Ket state;
+    if (this->start_state.empty()) {
+        state = qs::tensor_reduce(this->qubits);
+    } else {
+        state = qs::Ket(this->start_state.size(), this->start_state, "psi");
+    }
+    qs::_normalize(state.items, this->n_threads);
+    return state;
+}
+
+void qs::QuantumCircuit::add_gate(qs::Gate gate) {
+    if (!this->condition_bits.empty() && gate.type != qs::GateType::BARRIER) {
+        qs::check_err(!gate.condition_bits.empty(), "add_gate", "gate is already conditioned");
+        gate.condition(this->condition_bits, this->condition_value);
+    }
+    this->gates.push_back(gate);
+    // run executes the compiled gates, so they have to be compiled again
+    this->compiled = false;
 }
 
 void qs::QuantumCircuit::barrier() {
-    this->gates.push_back(qs::Barrier());
+    this->gates.push_back(qs::Gate());
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::snapshot(std::string path) {
+    qs::check_err(path.empty(), "snapshot", "empty path of the snapshot file");
+    qs::Gate gate;
+    gate.snapshot = path;
+    gate.position = this->gates.size();
+    gate.label = "snapshot " + path;
+    this->gates.push_back(gate);
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::resume(std::string path) {
+    qs::SnapshotHeader header = qs::_read_snapshot_header(path);
+    qs::check_err(header.n_qubits != this->n_qubits, "resume", "snapshot has a different number of qubits");
+
+    // the snapshot barrier stays at the same position as long as the circuit is built in the same way
+    bool found = header.gate < this->gates.size();
+    if (found) {
+        qs::Gate &gate = this->gates[header.gate];
+        found = gate.type == qs::GateType::BARRIER && !gate.snapshot.empty() && gate.position == header.gate;
+    }
+    qs::check_err(!found, "resume", "snapshot was not written by a barrier of this circuit");
+
+    this->start_state = qs::_read_snapshot(path, this->n_threads);
+    this->gates.erase(this->gates.begin(), this->gates.begin() + header.gate);
+    // the state is already saved there
+    this->gates[0].snapshot.clear();
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::gate(qs::Unitary gate, int qubit) {
+    qs::check_range("gate", qubit, this->n_qubits);
+    qs::check_err(this->measurement_mapping[qubit] != -1, "gate", "qubit is already measured");
+    qs::check_dims("gate", gate.dim, 2);
+
+    this->add_gate(qs::Gate(gate, qubit));
+}
+
+void qs::QuantumCircuit::gate(qs::Unitary gate, std::vector<int> qubits) {
+    for (int qubit : qubits) {
+        qs::check_range("gate", qubit, this->n_qubits);
+        qs::check_err(this->measurement_mapping[qubit] != -1, "gate", "qubit is already measured");
+    }
+
+    // multi-qubit gate acts on all given qubits at once
+    if (gate.dim != 2) {
+        this->add_gate(qs::Gate(gate, qubits));
+        return;
+    }
+
+    for (int qubit : qubits) {
+        this->add_gate(qs::Gate(gate, qubit));
+    }
+}
+
+void qs::QuantumCircuit::gate(qs::Unitary gate) {
+    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
+        qs::check_err(this->measurement_mapping[qubit] != -1, "gate", "qubit is already measured");
+    }
+    qs::check_dims("gate", gate.dim, 2);
+
+    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
+        this->add_gate(qs::Gate(gate, qubit));
+    }
+}
+
+void qs::QuantumCircuit::cgate(qs::Unitary gate, int control, int target) {
+    qs::check_range("cgate", control, this->n_qubits);
+    qs::check_range("cgate", target, this->n_qubits);
+    qs::check_err(this->measurement_mapping[control] != -1, "cgate", "control qubit is already measured");
+    qs::check_err(this->measurement_mapping[target] != -1, "cgate", "target qubit is already measured");
+    qs::check_err(control == target, "cgate", "control and target qubits are the samed");
+    qs::check_dims("cgate", gate.dim, 2);
+
+    this->add_gate(qs::Gate(gate, {target}, {control}));
+}
+
+void qs::QuantumCircuit::cgate(qs::Unitary gate, std::vector<int> controls, std::vector<int> targets) {
+    qs::check_err(controls.empty(), "cgate", "no control qubits");
+    for (int control : controls) {
+        qs::check_range("cgate", control, this->n_qubits);
+        qs::check_err(this->measurement_mapping[control] != -1, "cgate", "control qubit is already measured");
+        for (int target : targets) {
+            qs::check_err(control == target, "cgate", "control and target qubits are the samed");
+        }
+    }
+    for (int target : targets) {
+        qs::check_range("cgate", target, this->n_qubits);
+        qs::check_err(this->measurement_mapping[target] != -1, "cgate", "target qubit is already measured");
+    }
+
+    // multi-qubit gate acts on all target qubits at once
+    if (gate.dim != 2) {
+        this->add_gate(qs::Gate(gate, targets, controls));
+        return;
+    }
+
+    for (int target : targets) {
+        this->add_gate(qs::Gate(gate, {target}, controls));
+    }
+}
+
+void qs::QuantumCircuit::oracle(qs::QuantumCircuit oracle) {
+    qs::check_err(oracle.n_qubits != this->n_qubits, "oracle", "oracle dimension mismatch");
+
+    // inline the gates of the oracle instead of multiplying them into a single 2^n x 2^n matrix
+    for (qs::Gate &gate : oracle.gates) {
+        this->add_gate(gate);
+    }
+}
+
+void qs::QuantumCircuit::noise(qs::Channel channel, int qubit) {
+    qs::check_range("noise", qubit, this->n_qubits);
+    qs::check_err(this->measurement_mapping[qubit] != -1, "noise", "qubit is already measured");
+    qs::check_dims("noise", channel.dim, 2);
+
+    this->add_gate(qs::Gate(channel, {qubit}));
+}
+
+void qs::QuantumCircuit::noise(qs::Channel channel, std::vector<int> qubits) {
+    for (int qubit : qubits) {
+        qs::check_range("noise", qubit, this->n_qubits);
+        qs::check_err(this->measurement_mapping[qubit] != -1, "noise", "qubit is already measured");
+    }
+
+    // multi-qubit channel acts on all given qubits at once
+    if (channel.dim != 2) {
+        this->add_gate(qs::Gate(channel, qubits));
+        return;
+    }
+
+    for (int qubit : qubits) {
+        this->add_gate(qs::Gate(channel, {qubit}));
+    }
+}
+
+void qs::QuantumCircuit::gate_noise(qs::Channel channel) {
+    qs::check_dims("gate_noise", channel.dim, 2);
+    this->gate_channels.push_back(channel);
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::readout_error(int qubit, double p01, double p10) {
+    qs::check_range("readout_error", qubit, this->n_qubits);
+    qs::check_err(p01 < 0 || p01 > 1 || p10 < 0 || p10 > 1, "readout_error", "probability must be in [0, 1]");
+    this->readout_p01[qubit] = p01;
+    this->readout_p10[qubit] = p10;
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::readout_error(double p01, double p10) {
+    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
+        this->readout_error(qubit, p01, p10);
+    }
+}
+
+bool qs::QuantumCircuit::is_noisy() {
+    if (!this->gate_channels.empty()) {
+        return true;
+    }
+    for (qs::Gate &gate : this->gates) {
+        if (gate.type == qs::GateType::CHANNEL) {
+            return true;
+        }
+    }
+    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
+        if (this->readout_p01[qubit] != 0 || this->readout_p10[qubit] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<qs::Gate> qs::QuantumCircuit::noisy_gates() {
+    if (this->gate_channels.empty()) {
+        return this->gates;
+    }
+
+    std::vector<qs::Gate> noisy;
+    for (qs::Gate &gate : this->gates) {
+        noisy.push_back(gate);
+        if (gate.type != qs::GateType::UNITARY && gate.type != qs::GateType::FUNCTION) {
+            continue;
+        }
+        for (int qubit : gate.qubits()) {
+            for (qs::Channel &channel : this->gate_channels) {
+                // noise of a conditioned gate occurs only if the gate is applied
+                qs::Gate noise(channel, {qubit});
+                if (!gate.condition_bits.empty()) {
+                    noise.condition(gate.condition_bits, gate.condition_value);
+                }
+                noisy.push_back(noise);
+            }
+        }
+    }
+    return noisy;
+}
+
+void qs::QuantumCircuit::measure(int qubit, int bit) {
+    qs::check_range("measure [qubit]", qubit, this->n_qubits);
+    qs::check_range("measure [bit]", bit, this->n_bits);
+
+    // check if the classical bit was already assigned
+    for (int i = 0; i < this->n_qubits; ++i) {
+        qs::check_err(this->measurement_mapping[i] == bit, "measure", "classical bit is already assigned to another qubit");
+    }
+
+    this->measurement_mapping[qubit] = bit;
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::mid_measure(int qubit, int bit) {
+    qs::check_range("mid_measure [qubit]", qubit, this->n_qubits);
+    qs::check_range("mid_measure [bit]", bit, this->n_bits);
+    qs::check_err(this->measurement_mapping[qubit] != -1, "mid_measure", "qubit is already measured");
+
+    this->add_gate(qs::Gate(qs::GateType::MEASURE, qubit, bit));
+}
+
+void qs::QuantumCircuit::reset(int qubit) {
+    qs::check_range("reset", qubit, this->n_qubits);
+    qs::check_err(this->measurement_mapping[qubit] != -1, "reset", "qubit is already measured");
+
+    this->add_gate(qs::Gate(qs::GateType::RESET, qubit));
+}
+
+void qs::QuantumCircuit::condition(int bit, int value) {
+    this->condition(std::vector<int>{bit}, value);
+}
+
+void qs::QuantumCircuit::condition(std::vector<int> bits, qs::bitmask value) {
+    for (int bit : bits) {
+        qs::check_range("condition", bit, this->n_bits);
+    }
+    qs::check_err(bits.empty(), "condition", "no classical bits");
+    qs::check_err(bits.size() < 64 && value >> bits.size() != 0, "condition", "value does not fit into the classical bits");
+
+    this->condition_bits = bits;
+    this->condition_value = value;
+}
+
+void qs::QuantumCircuit::end_condition() {
+    this->condition_bits.clear();
+}
+
+bool qs::QuantumCircuit::is_dynamic() {
+    for (qs::Gate &gate : this->gates) {
+        if (gate.is_dynamic()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool qs::QuantumCircuit::has_snapshots() {
+    for (qs::Gate &gate : this->gates) {
+        if (!gate.snapshot.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void qs::QuantumCircuit::bind(std::string name, double value) {
+    this->parameter_values[name] = value;
+    this->bound = false;
+}
+
+void qs::QuantumCircuit::bind(std::map<std::string, double> values) {
+    for (auto &item : values) {
+        this->parameter_values[item.first] = item.second;
+    }
+    this->bound = false;
+}
+
+std::vector<std::string> qs::QuantumCircuit::parameters() {
+    std::vector<std::string> names;
+    for (qs::Gate &gate : this->gates) {
+        if (gate.type != qs::GateType::UNITARY) {
+            continue;
+        }
+        for (qs::Parameter &parameter : gate.matrix.parameters) {
+            if (parameter.is_symbol() && std::find(names.begin(), names.end(), parameter.name) == names.end()) {
+                names.push_back(parameter.name);
+            }
+        }
+    }
+    return names;
+}
+
+void qs::QuantumCircuit::bind_gates() {
+    if (this->bound) {
+        return;
+    }
+    // parameterized gates are never fused or converted to the tableau, so only their own small matrices are recomputed
+    if (this->compiled_backend != qs::Backend::STABILIZER) {
+        for (qs::Gate &gate : this->compiled_gates) {
+            if (gate.is_parametric()) {
+                gate.bind(this->parameter_values);
+            }
+        }
+    }
+    this->bound = true;
+}
+
+void qs::QuantumCircuit::set_threads(int n_threads) {
+    qs::check_err(n_threads < 1, "set_threads", "at least one thread is required");
+    this->n_threads = n_threads;
+}
+
+void qs::QuantumCircuit::set_fusion(int max_qubits) {
+    qs::check_err(max_qubits < 0, "set_fusion", "negative size of fused gates");
+    this->fusion_size = max_qubits;
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::set_backend(qs::Backend backend) {
+    this->backend = backend;
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::set_mps(int max_bond, double cutoff) {
+    qs::check_err(max_bond < 1, "set_mps", "bond dimension must be positive");
+    qs::check_err(cutoff < 0 || cutoff >= 1, "set_mps", "truncation threshold must be in [0, 1)");
+    this->max_bond = max_bond;
+    this->mps_cutoff = cutoff;
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::set_sparse(double density) {
+    qs::check_err(density <= 0 || density > 1, "set_sparse", "density must be in (0, 1]");
+    this->sparse_density = density;
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::set_trajectories(int n_trajectories) {
+    qs::check_err(n_trajectories < 0, "set_trajectories", "number of trajectories must not be negative");
+    this->n_trajectories = n_trajectories;
+    this->compiled = false;
+}
+
+void qs::QuantumCircuit::set_branching(int max_copies) {
+    qs::check_err(max_copies < 1, "set_branching", "number of state copies must be positive");
+    this->max_copies = max_copies;
+    this->compiled = false;
+}
+
+qs::Backend qs::QuantumCircuit::get_backend() {
+    qs::check_err(!this->compiled, "get_backend", "circuit was not compiled");
+    return this->compiled_backend;
+}
+
+// shift qubits of the gate to the column qubits n, ..., 2n - 1 of the vectorized density matrix
+static std::vector<int> column_qubits(std::vector<int> &qubits, int n_qubits) {
+    std::vector<int> shifted;
+    for (int qubit : qubits) {
+        shifted.push_back(qubit + n_qubits);
+    }
+    return shifted;
+}
+
+// append gates acting on the vectorized density matrix, rho -> U rho U^+ applies U to the rows and conj(U) to the columns
+// and a channel is applied as its superoperator on the row and column qubits at once
+static void add_density_gates(qs::Gate &gate, int n_qubits, std::vector<qs::Gate> &density_gates) {
+    std::vector<int> targets = column_qubits(gate.targets, n_qubits);
+    std::vector<int> controls = column_qubits(gate.controls, n_qubits);
+
+    switch (gate.type) {
+        case qs::GateType::UNITARY: {
+            qs::c_mat conjugate(gate.matrix.dim);
+            for (int r = 0; r < gate.matrix.dim; ++r) {
+                for (int c = 0; c < gate.matrix.dim; ++c) {
+                    conjugate[r][c] = gate.matrix.items[r][c].conjugate();
+                }
+            }
+            qs::Unitary column(gate.matrix.dim, conjugate, gate.matrix.label + "*");
+            // the column half of a parameterized gate is regenerated and conjugated when the values are bound
+            column.parameters = gate.matrix.parameters;
+            column.generator = gate.matrix.generator;
+            column.conjugated = !gate.matrix.conjugated;
+            density_gates.push_back(gate);
+            density_gates.push_back(qs::Gate(column, targets, gate.controls.empty() ? std::vector<int>{} : controls));
+            return;
+        }
+        case qs::GateType::FUNCTION:
+            density_gates.push_back(gate);
+            density_gates.push_back(qs::Gate(*gate.table, controls, targets, "Uf*"));
+            return;
+        case qs::GateType::CHANNEL: {
+            std::vector<int> qubits(gate.targets);
+            qubits.insert(qubits.end(), targets.begin(), targets.end());
+            int dim = gate.channel->dim;
+            density_gates.push_back(qs::Gate(qs::Unitary(dim * dim, gate.channel->superoperator(), gate.channel->label), qubits));
+            return;
+        }
+        default:
+            density_gates.push_back(gate);
+    }
+}
+
+void qs::QuantumCircuit::compile() {
+    if (this->compiled) {
+        return;
+    }
+    // new compiled gates start from zero angles
+    this->bound = false;
+
+    int n = this->gates.size();
+
+    // circuit with a prepared state can only measure it
+    qs::check_err(n == 0 && this->start_state.empty(), "compile", "no gates to compile");
+
+    // configure measurements
+    bool all_classical_used = true;
+    for (int bit = 0; bit < this->n_bits; ++bit) {
+        bool found = false;
+        for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
+            if (this->measurement_mapping[qubit] == bit) {
+                found = true;
+                break;
+            }
+        }
+        // bits written only by mid-circuit measurements are used as well
+        for (qs::Gate &gate : this->gates) {
+            found = found || (gate.type == qs::GateType::MEASURE && gate.bit == bit);
+        }
+        if (!found) {
+            all_classical_used = false;
+            break;
+        }
+    }
+
+    qs::check_err(!all_classical_used, "compile", "not all classical bits are used, either remove the extra ones or use them for some qubit");
+
+    this->measured_qubits.resize(0);
+    // bits without a measurement at the end keep -1, they are written only by mid-circuit measurements
+    this->measured_bits = std::vector<int>(this->n_bits, -1);
+    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
+        if (this->measurement_mapping[qubit] != -1) {
+            this->measured_qubits.push_back(qubit);
+            this->measured_bits[this->measurement_mapping[qubit]] = qs::_qubit_bit(qubit, this->n_qubits);
+        }
+    }
+
+    // noise turns the pure state into a mixed one, which is simulated as a density matrix for small circuits
+    // and sampled by trajectories of pure states for large ones
+    // mid-circuit measurements make the shots differ, so they are always simulated by trajectories of the state vector
+    bool noisy = this->is_noisy();
+    bool dynamic = this->is_dynamic();
+    bool noisy_backend = this->backend == qs::Backend::DENSITY_MATRIX || this->backend == qs::Backend::TRAJECTORIES;
+    // snapshots hold a single pure state, which other backends either do not have or do not share between shots
+    bool snapshots = this->has_snapshots();
+    qs::check_err(snapshots && (noisy || dynamic || noisy_backend || this->backend == qs::Backend::MPS || this->backend == qs::Backend::STABILIZER), "compile", "snapshots are supported only by noiseless circuits on the state vector");
+    if (noisy || dynamic || noisy_backend) {
+        qs::check_err(this->backend != qs::Backend::AUTOMATIC && !noisy_backend && (noisy || this->backend != qs::Backend::STATE_VECTOR), "compile", "noise is supported only by the density matrix and trajectory backends, mid-circuit measurements also by the state vector");
+        qs::check_err(dynamic && this->backend == qs::Backend::DENSITY_MATRIX, "compile", "mid-circuit measurements are not supported by the density matrix backend");
+        // registers of trajectories and conditions on them are packed into a bitmask
+        qs::check_err(this->n_bits > qs::bitmask_bits, "compile", "noisy and dynamic circuits support at most 64 classical bits");
+        bool density = !dynamic && (this->backend == qs::Backend::DENSITY_MATRIX || (this->backend == qs::Backend::AUTOMATIC && this->n_qubits <= qs::max_density_qubits));
+        this->compiled_backend = density ? qs::Backend::DENSITY_MATRIX : qs::Backend::TRAJECTORIES;
+
+        this->full_qubit = this->initial_state();
+
+        std::vector<qs::Gate> noisy_gates = this->noisy_gates();
+        if (density) {
+            std::vector<qs::Gate> density_gates;
+            for (qs::Gate &gate : noisy_gates) {
+                add_density_gates(gate, this->n_qubits, density_gates);
+            }
+            noisy_gates = density_gates;
+        }
+        // row and column halves of the gates act on disjoint qubits, so the fusion can merge them into common blocks
+        // channels of trajectories are not unitary and split the fused blocks
+        this->compiled_gates = qs::fuse_gates(noisy_gates, this->fusion_size);
+        for (qs::Gate &gate : this->compiled_gates) {
+            gate.classify();
+        }
+
+        // gates before the first channel or measurement are the same in all trajectories
+        this->prefix_length = 0;
+        while (!density && this->prefix_length < this->compiled_gates.size()) {
+            qs::Gate &gate = this->compiled_gates[this->prefix_length];
+            if (gate.type == qs::GateType::CHANNEL || gate.is_dynamic()) {
+                break;
+            }
+            ++this->prefix_length;
+        }
+
+        this->compiled = true;
+        return;
+    }
+
+    // matrix product state applies gates on at most two qubits efficiently, larger blocks would need long swap chains
+    if (this->backend == qs::Backend::MPS) {
+        qs::check_err(!this->start_state.empty(), "compile", "matrix product state backend starts only from the initial qubits");
+        this->compiled_backend = qs::Backend::MPS;
+        this->compiled_gates = qs::fuse_gates(this->gates, std::min(this->fusion_size, 2));
+        this->compiled = true;
+        return;
+    }
+
+    // circuits of clifford gates on stabilizer states are simulated by the tableau
+    if (this->backend == qs::Backend::AUTOMATIC || this->backend == qs::Backend::STABILIZER) {
+        bool clifford = this->start_state.empty() && !snapshots;
+        this->clifford_prepare_ops.clear();
+        this->clifford_gate_ops = std::vector<std::vector<qs::TableauOp>>(this->gates.size());
+        for (int q = 0; q < this->n_qubits && clifford; ++q) {
+            clifford = qs::clifford_prepare(this->qubits[q], q, this->clifford_prepare_ops);
+        }
+        for (int i = 0; i < this->gates.size() && clifford; ++i) {
+            clifford = qs::clifford_ops(this->gates[i], this->clifford_gate_ops[i]);
+        }
+
+        qs::check_err(this->backend == qs::Backend::STABILIZER && !clifford, "compile", "stabilizer backend supports only clifford gates and stabilizer initial states");
+
+        if (clifford) {
+            this->compiled_backend = qs::Backend::STABILIZER;
+            this->compiled = true;
+            return;
+        }
+        this->clifford_prepare_ops.clear();
+        this->clifford_gate_ops.clear();
+    }
+
+    // outcomes of the state vector are read out for all indices of the measured qubits at once
+    qs::check_err(this->n_bits > qs::bitmask_bits, "compile", "state vector supports at most 64 classical bits, wider registers need the stabilizer or matrix product state backend");
+
+    // initial states on few basis states, such as |0...0>, are kept sparse until the gates populate enough of them
+    double nnz = 1;
+    if (this->start_state.empty()) {
+        for (qs::Ket &qubit : this->qubits) {
+            int populated = 0;
+            for (qs::Complex &x : qubit.items) {
+                populated += x.Re != 0 || x.Im != 0;
+            }
+            nnz *= populated;
+        }
+    } else {
+        nnz = 0;
+        for (qs::Complex &x : this->start_state) {
+            nnz += x.Re != 0 || x.Im != 0;
+        }
+    }
+    if (this->backend != qs::Backend::STATE_VECTOR && this->n_qubits < 64 && nnz <= this->sparse_density * ldexp(1.0, this->n_qubits)) {
+        this->compiled_backend = qs::Backend::SPARSE;
+
+        std::vector<qs::c_vec> kets;
+        for (qs::Ket &qubit : this->qubits) {
+            kets.push_back(qubit.items);
+        }
+        this->sparse_qubit = this->start_state.empty() ? qs::_sparse_product(kets) : qs::_to_sparse(this->start_state);
+        double norm = sqrt(qs::_sparse_norm2(this->sparse_qubit));
+        for (qs::Complex &x : this->sparse_qubit.amplitudes) {
+            x = x * qs::Complex(1 / norm);
+        }
+    } else {
+        this->compiled_backend = qs::Backend::STATE_VECTOR;
+
+        // reduce qubits into one qubit
+        this->full_qubit = this->initial_state();
+    }
+
+    // merge gates so that the state vector is visited fewer times
+    this->compiled_gates = qs::fuse_gates(this->gates, this->fusion_size);
+    // pick the kernel of every gate, diagonal and permutation gates are applied without matrix products
+    for (qs::Gate &gate : this->compiled_gates) {
+        gate.classify();
+    }
+
+    this->compiled = true;
 }
 
-void qs::QuantumCircuit::gate(qs::Unitary gate, int qubit) {
-    qs::check_range("gate", qubit, this->n_qubits);
-    qs::check_err(this->measurement_mapping[qubit] != -1, "gate", "qubit is already measured");
+qs::Unitary qs::QuantumCircuit::to_gate() {
+    qs::check_err(this->gates.empty(), "to_gate", "circuit has no gates");
+
+    int n = this->gates.size();
+
+    qs::Unitary gate;
+    bool first = true;
+
+    for (int i = n - 1; i >= 0; --i) {
+        if (this->gates[i].type != qs::GateType::BARRIER) {
+            // the matrix is built for the currently bound values
+            qs::Gate bound = this->gates[i];
+            if (bound.is_parametric()) {
+                bound.bind(this->parameter_values);
+            }
+            qs::Unitary full = bound.expand(this->n_qubits);
+            if (first) {
+                gate = full;
+                first = false;
+            } else {
+                gate = gate % full;
+            }
+        }
+    }
+
+    qs::check_err(first, "to_gate", "circuit has only barriers");
+
+    return gate;
+}
+
+qs::Results qs::QuantumCircuit::run(int shots, bool verbose) {
+    qs::check_err(!this->compiled, "run", "circuit was not compiled");
+    this->bind_gates();
+
+    if (this->compiled_backend == qs::Backend::STABILIZER) {
+        return this->run_stabilizer(shots, verbose);
+    }
+    if (this->compiled_backend == qs::Backend::MPS) {
+        return this->run_mps(shots, verbose);
+    }
+    if (this->compiled_backend == qs::Backend::DENSITY_MATRIX) {
+        return this->run_density(shots, verbose);
+    }
+    if (this->compiled_backend == qs::Backend::TRAJECTORIES) {
+        return this->run_trajectories(shots, verbose);
+    }
+
+    // the sparse state is converted to the dense one once it populates too many basis states
+    bool sparse = this->compiled_backend == qs::Backend::SPARSE;
+    std::size_t dim = (std::size_t)1 << this->n_qubits;
+    qs::SparseVec sparse_res;
+    qs::c_vec ket_res;
+    if (sparse) {
+        sparse_res = this->sparse_qubit;
+    } else {
+        ket_res = this->full_qubit.items;
+    }
+
+    if (verbose)
+        std::cout << "Steps of the circuit [" << "G is applied gate, Q is state vector in a step" << "]:" << std::endl;
+
+    int k = 0;
+    for (qs::Gate &gate : this->compiled_gates) {
+        if (verbose) {
+            std::cout << "$ (" << k++ << ") ";
+            if (gate.type == qs::GateType::BARRIER) {
+                std::cout << "Q: ";
+                if (sparse) {
+                    qs::print_sparse(sparse_res, this->n_qubits);
+                } else {
+                    qs::print_vec(ket_res, true);
+                }
+                std::cout << std::endl;
+            } else {
+                std::cout << "G: ";
+                gate.symbol();
+                std::cout << std::endl;
+            }
+        }
+
+        if (!gate.snapshot.empty()) {
+            if (sparse) {
+                qs::c_vec dense = qs::_to_dense(sparse_res, dim);
+                qs::_write_snapshot(gate.snapshot, dense, this->n_qubits, gate.position, this->n_threads);
+            } else {
+                qs::_write_snapshot(gate.snapshot, ket_res, this->n_qubits, gate.position, this->n_threads);
+            }
+        }
+
+        if (!sparse) {
+            // update the amplitudes in place
+            gate.apply(ket_res, this->n_qubits, this->n_threads);
+            continue;
+        }
+
+        gate.apply(sparse_res, this->n_qubits);
+        if (qs::_nnz(sparse_res) > this->sparse_density * dim) {
+            ket_res = qs::_to_dense(sparse_res, dim);
+            sparse_res = qs::SparseVec();
+            sparse = false;
+        }
+    }
+
+    qs::Results results(shots, this->n_bits);
+
+    // read out the distribution over measured qubits directly from the amplitudes
+    if (sparse) {
+        for (const std::pair<const std::size_t, double> &key_val : qs::_sparse_probabilities(sparse_res, this->measured_bits)) {
+            results.add_outcome(key_val.first, key_val.second);
+        }
+    } else {
+        std::vector<double> probs = qs::_probabilities(ket_res, this->measured_bits, this->n_threads);
+        for (std::size_t bits = 0; bits < probs.size(); ++bits) {
+            results.add_outcome(bits, probs[bits]);
+        }
+    }
+
+    // conduct experiment on the outcomes
+    results.run();
+
+    return results;
+}
+
+qs::Results qs::QuantumCircuit::run_stabilizer(int shots, bool verbose) {
+    qs::Tableau tableau(this->n_qubits);
+    for (qs::TableauOp &op : this->clifford_prepare_ops) {
+        tableau.apply(op);
+    }
+
+    if (verbose)
+        std::cout << "Steps of the circuit [" << "G is applied gate, S are stabilizers in a step" << "]:" << std::endl;
+
+    for (int i = 0; i < this->gates.size(); ++i) {
+        if (verbose) {
+            std::cout << "$ (" << i << ") ";
+            if (this->gates[i].type == qs::GateType::BARRIER) {
+                std::cout << "S:";
+                for (std::string &stabilizer : tableau.stabilizers()) {
+                    std::cout << " " << stabilizer;
+                }
+            } else {
+                std::cout << "G: ";
+                this->gates[i].symbol();
+            }
+            std::cout << std::endl;
+        }
+
+        for (qs::TableauOp &op : this->clifford_gate_ops[i]) {
+            tableau.apply(op);
+        }
+    }
+
+    // qubit measured into every classical bit
+    std::vector<int> bit_qubits(this->n_bits);
+    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
+        if (this->measurement_mapping[qubit] != -1) {
+            bit_qubits[this->measurement_mapping[qubit]] = qubit;
+        }
+    }
+
+    // measure all classical bits on a copy of the tableau and count the random measurements
+    // the tableau holds many more qubits than a bitmask, so the outcomes are kept as bit strings
+    auto measure_shot = [&](std::mt19937 &rng, int &n_random) {
+        qs::Tableau sample = tableau;
+        std::string bits(this->n_bits, '0');
+        n_random = 0;
+        for (int bit = 0; bit < this->n_bits; ++bit) {
+            if (!sample.is_deterministic(bit_qubits[bit])) {
+                ++n_random;
+            }
+            if (sample.measure(bit_qubits[bit], rng)) {
+                bits[bit] = '1';
+            }
+        }
+        return bits;
+    };
+
+    std::random_device rd;
+    std::mt19937 rng(rd());
+
+    // every outcome of a stabilizer state has probability 2^-r, where r is the number of random measurements
+    int n_random = 0;
+    std::map<std::string, int> counts;
+    if (shots > 0) {
+        counts[measure_shot(rng, n_random)] = 1;
+    }
+
+    // without random measurements all shots give the same outcome, otherwise the other shots are split among threads
+    if (n_random == 0) {
+        for (std::pair<const std::string, int> &key_val : counts) {
+            key_val.second = shots;
+        }
+    } else if (shots > 1) {
+        std::size_t chunk = qs::_chunk_size(shots - 1, 16);
+        std::size_t n_chunks = (shots - 1 + chunk - 1) / chunk;
+        std::vector<std::uint32_t> seeds(n_chunks);
+        for (std::uint32_t &seed : seeds) {
+            seed = rng();
+        }
+        std::vector<std::map<std::string, int>> partial(n_chunks);
+        qs::_parallel_for(shots - 1, this->n_threads, [&](std::size_t begin, std::size_t end) {
+            std::mt19937 chunk_rng(seeds[begin / chunk]);
+            int chunk_random;
+            for (std::size_t shot = begin; shot < end; ++shot) {
+                ++partial[begin / chunk][measure_shot(chunk_rng, chunk_random)];
+            }
+        }, 16);
+        for (std::map<std::string, int> &chunk_counts : partial) {
+            for (const std::pair<const std::string, int> &key_val : chunk_counts) {
+                counts[key_val.first] += key_val.second;
+            }
+        }
+    }
+
+    qs::Results results(shots, this->n_bits);
+    for (const std::pair<const std::string, int> &key_val : counts) {
+        std::string bits = key_val.first;
+        results.add_sampled(bits, key_val.second, ldexp(1.0, -n_random));
+    }
+
+    return results;
+}
+
+qs::Results qs::QuantumCircuit::run_density(int shots, bool verbose) {
+    qs::c_vec rho = qs::_density_matrix(this->full_qubit.items, this->n_threads);
+    std::size_t dim = (std::size_t)1 << this->n_qubits;
+
+    if (verbose)
+        std::cout << "Steps of the circuit [" << "G is applied gate, R is density matrix in a step" << "]:" << std::endl;
+
+    int k = 0;
+    for (qs::Gate &gate : this->compiled_gates) {
+        if (verbose) {
+            std::cout << "$ (" << k++ << ") ";
+            if (gate.type == qs::GateType::BARRIER) {
+                std::cout << "R: " << std::endl;
+                qs::c_mat matrix(dim);
+                std::copy(rho.begin(), rho.end(), matrix.flat().begin());
+                qs::print_mat(matrix);
+            } else {
+                std::cout << "G: ";
+                gate.symbol();
+                std::cout << std::endl;
+            }
+        }
+
+        // rows and columns are updated in place as a state of 2n qubits
+        gate.apply(rho, 2 * this->n_qubits, this->n_threads);
+    }
+
+    qs::Results results(shots, this->n_bits);
+
+    // distribution over measured qubits is the diagonal of rho, then every classical bit is misread independently
+    std::vector<double> probs = qs::_dm_probabilities(rho, this->n_qubits, this->measured_bits);
+    for (int bit = 0; bit < this->n_bits; ++bit) {
+        int qubit = this->n_qubits - 1 - this->measured_bits[bit];
+        if (this->readout_p01[qubit] != 0 || this->readout_p10[qubit] != 0) {
+            qs::_apply_readout(probs, this->n_bits - 1 - bit, this->readout_p01[qubit], this->readout_p10[qubit]);
+        }
+    }
+    for (std::size_t bits = 0; bits < probs.size(); ++bits) {
+        results.add_outcome(bits, probs[bits]);
+    }
+
+    results.run();
+
+    return results;
+}
 
-    std::vector<qs::Unitary> sub_gates = std::vector<qs::Unitary>(this->n_qubits, qs::Identity());
-    sub_gates[qubit] = gate;
-    this->gates.push_back(qs::tensor_reduce(sub_gates));
+// Kraus operators of a channel prepared for sampling of trajectories
+struct KrausGates {
+    // K_i as gates, scaled to unitaries K_i / sqrt(w_i) if the channel is mixed unitary
+    std::vector<qs::Gate> gates;
+    // state independent probabilities w_i of mixed unitary channels, empty otherwise
+    std::vector<double> weights;
+    // K_i^+ K_i whose expectation values are the probabilities of the operators otherwise
+    std::vector<qs::c_mat> effects;
+};
+
+static KrausGates kraus_gates(qs::Gate &gate) {
+    qs::Channel &channel = *gate.channel;
+    KrausGates kraus;
+    kraus.weights = channel.kraus_weights();
+    for (std::size_t i = 0; i < channel.kraus.size(); ++i) {
+        qs::c_mat k = channel.kraus[i];
+        if (!kraus.weights.empty()) {
+            qs::Complex scale(kraus.weights[i] > 0 ? 1 / std::sqrt(kraus.weights[i]) : 0);
+            for (int r = 0; r < channel.dim; ++r) {
+                for (int c = 0; c < channel.dim; ++c) {
+                    k[r][c] *= scale;
+                }
+            }
+        } else {
+            qs::c_mat effect(channel.dim);
+            for (int r = 0; r < channel.dim; ++r) {
+                for (int c = 0; c < channel.dim; ++c) {
+                    for (int j = 0; j < channel.dim; ++j) {
+                        effect[r][c] += channel.kraus[i][j][r].conjugate() * channel.kraus[i][j][c];
+                    }
+                }
+            }
+            kraus.effects.push_back(effect);
+        }
+        kraus.gates.push_back(qs::Gate(qs::Unitary(channel.dim, k, channel.label), gate.targets));
+        kraus.gates.back().classify();
+    }
+    return kraus;
 }
 
-void qs::QuantumCircuit::gate(qs::Unitary gate, std::vector<int> qubits) {
-    for (int qubit : qubits) {
-        qs::check_range("gate", qubit, this->n_qubits);
-        qs::check_err(this->measurement_mapping[qubit] != -1, "gate", "qubit is already measured");
+// probabilities of the outcomes of a channel or a measurement of the state
+// the probabilities |K_i |psi>|^2 of mixed unitary channels do not depend on the state,
+// otherwise they are read from the reduced density matrix of the target qubits
+static std::vector<double> event_probabilities(qs::Gate &gate, KrausGates &kraus, qs::c_vec &state, int n_qubits, int n_threads) {
+    std::vector<int> bits = qs::Gate::bits(gate.targets, n_qubits);
+    if (gate.type != qs::GateType::CHANNEL) {
+        return qs::_probabilities(state, bits, n_threads);
+    }
+    if (!kraus.weights.empty()) {
+        return kraus.weights;
     }
 
-    std::vector<qs::Unitary> sub_gates = std::vector<qs::Unitary>(this->n_qubits, qs::Identity());
-    for (int qubit : qubits) {
-        sub_gates[qubit] = gate;
+    qs::c_mat rho = qs::_reduced_density_matrix(state, bits, n_threads);
+    int dim = rho.size();
+    std::vector<double> probs;
+    for (qs::c_mat &effect : kraus.effects) {
+        double p = 0;
+        for (int a = 0; a < dim; ++a) {
+            for (int b = 0; b < dim; ++b) {
+                p += (effect[a][b] * rho[b][a]).Re;
+            }
+        }
+        probs.push_back(std::max(p, 0.0));
     }
-    this->gates.push_back(qs::tensor_reduce(sub_gates));
+    return probs;
 }
 
-void qs::QuantumCircuit::gate(qs::Unitary gate) {
-    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
-        qs::check_err(this->measurement_mapping[qubit] != -1, "gate", "qubit is already measured");
+// choose outcome for uniform r, the last outcome with nonzero probability is chosen if rounding errors push r beyond the sum
+static int choose_outcome(std::vector<double> &probs, double r) {
+    int chosen = -1;
+    double cumulative = 0;
+    for (int i = 0; i < probs.size(); ++i) {
+        cumulative += probs[i];
+        if (probs[i] > qs::Results::p_tolerance) {
+            chosen = i;
+            if (r < cumulative) {
+                break;
+            }
+        }
     }
-
-    std::vector<qs::Unitary> sub_gates = std::vector<qs::Unitary>(this->n_qubits, gate);
-    this->gates.push_back(qs::tensor_reduce(sub_gates));
+    return chosen;
 }
 
-void qs::QuantumCircuit::cgate(qs::Unitary gate, int control, int target) {
-    qs::check_range("cgate", control, this->n_qubits);
-    qs::check_range("cgate", target, this->n_qubits);
-    qs::check_err(this->measurement_mapping[control] != -1, "cgate", "control qubit is already measured");
-    qs::check_err(this->measurement_mapping[target] != -1, "cgate", "target qubit is already measured");
-    qs::check_err(control == target, "cgate", "control and target qubits are the samed");
-
-    qs::Unitary proj0 = qs::Proj(qs::BasicQubits::ZERO);
-    qs::Unitary proj1 = qs::Proj(qs::BasicQubits::ONE);
-    std::vector<qs::Unitary> inactive_parts;
-    std::vector<qs::Unitary> active_parts;
-    for (int i = 0; i < this->n_qubits; ++i) {
-        if (i == target) {
-            active_parts.push_back(gate);
-            inactive_parts.push_back(qs::Identity());
-        } else if (i == control) {
-            active_parts.push_back(proj1);
-            inactive_parts.push_back(proj0);
-        } else {
-            active_parts.push_back(qs::Identity());
-            inactive_parts.push_back(qs::Identity());
+// replace the state by K_i |psi> / |K_i |psi>| for a channel or collapse it to the outcome of a measurement or reset
+static void apply_outcome(qs::Gate &gate, KrausGates &kraus, qs::c_vec &state, int n_qubits, int outcome, double p, int n_threads) {
+    if (gate.type == qs::GateType::CHANNEL) {
+        kraus.gates[outcome].apply(state, n_qubits, n_threads);
+        if (kraus.weights.empty()) {
+            qs::_normalize(state, n_threads);
         }
+        return;
     }
-    qs::Unitary inactive = qs::tensor_reduce(inactive_parts);
-    qs::Unitary active = qs::tensor_reduce(active_parts);
-    qs::Unitary result = inactive + active;
-    result.label = "C" + gate.label + "[" + std::to_string(control) + "," + std::to_string(target) + "]";
-    this->gates.push_back(result);
+    int bit = qs::_qubit_bit(gate.targets[0], n_qubits);
+    qs::_collapse(state, bit, outcome, gate.type == qs::GateType::RESET ? 0 : outcome, p, n_threads);
 }
 
-void qs::QuantumCircuit::oracle(qs::QuantumCircuit oracle) {
-    qs::check_err(oracle.n_qubits != this->n_qubits, "oracle", "oracle dimension mismatch");
+// draw basis state of the state vector for uniform r and return the values of the qubits at bit positions bits
+static std::size_t sample_final(qs::c_vec &state, std::vector<int> &bits, double r) {
+    std::size_t index = state.size() - 1;
+    double cumulative = 0;
+    for (std::size_t i = 0; i < state.size(); ++i) {
+        cumulative += state[i].Re * state[i].Re + state[i].Im * state[i].Im;
+        if (r < cumulative) {
+            index = i;
+            break;
+        }
+    }
 
-    this->gates.push_back(oracle.to_gate());
+    std::size_t local = 0;
+    for (int bit : bits) {
+        local = (local << 1) | ((index >> bit) & 1);
+    }
+    return local;
 }
 
-void qs::QuantumCircuit::measure(int qubit, int bit) {
-    qs::check_range("measure [qubit]", qubit, this->n_qubits);
-    qs::check_range("measure [bit]", bit, this->n_bits);
+qs::Results qs::QuantumCircuit::run_trajectories(int shots, bool verbose) {
+    if (verbose) {
+        std::cout << "Steps of the circuit [" << "G is applied gate, K is sampled channel, M is measurement or reset, states of trajectories are not printed" << "]:" << std::endl;
+        int k = 0;
+        for (qs::Gate &gate : this->compiled_gates) {
+            if (gate.type == qs::GateType::BARRIER) {
+                continue;
+            }
+            bool measurement = gate.type == qs::GateType::MEASURE || gate.type == qs::GateType::RESET;
+            std::cout << "$ (" << k++ << ") " << (gate.type == qs::GateType::CHANNEL ? "K: " : measurement ? "M: " : "G: ");
+            gate.symbol();
+            std::cout << std::endl;
+        }
+    }
 
-    // check if the classical bit was already assigned
-    for (int i = 0; i < this->n_qubits; ++i) {
-        qs::check_err(this->measurement_mapping[i] == bit, "measure", "classical bit is already assigned to another qubit");
+    std::vector<KrausGates> kraus(this->compiled_gates.size());
+    for (std::size_t i = 0; i < this->compiled_gates.size(); ++i) {
+        if (this->compiled_gates[i].type == qs::GateType::CHANNEL) {
+            kraus[i] = kraus_gates(this->compiled_gates[i]);
+        }
     }
 
-    this->measurement_mapping[qubit] = bit;
-}
+    // classical bits measured at the end together with the readout error of their qubits
+    // bits of mid-circuit measurements are misread already when they are written
+    std::vector<int> final_bits;
+    std::vector<int> final_positions;
+    std::vector<double> p01(this->n_bits, 0), p10(this->n_bits, 0);
+    bool readout = false;
+    for (int bit = 0; bit < this->n_bits; ++bit) {
+        if (this->measured_bits[bit] == -1) {
+            continue;
+        }
+        final_bits.push_back(bit);
+        final_positions.push_back(this->measured_bits[bit]);
+        int qubit = this->n_qubits - 1 - this->measured_bits[bit];
+        p01[bit] = this->readout_p01[qubit];
+        p10[bit] = this->readout_p10[qubit];
+        readout = readout || p01[bit] != 0 || p10[bit] != 0;
+    }
+    int n_final = final_bits.size();
 
-void qs::QuantumCircuit::compile() {
-    if (this->compiled) {
-        return;
+    // the deterministic prefix is simulated once by all threads and copied by every trajectory
+    qs::c_vec prefix = this->full_qubit.items;
+    for (std::size_t i = 0; i < this->prefix_length; ++i) {
+        this->compiled_gates[i].apply(prefix, this->n_qubits, this->n_threads);
     }
 
-    int n = this->gates.size();
+    // draw shots from the final state, the final measurements overwrite the bits of the register
+    std::function<void(qs::c_vec &, qs::bitmask, int, std::mt19937 &, std::map<qs::bitmask, int> &)> record = [&](qs::c_vec &state, qs::bitmask reg, int run_shots, std::mt19937 &run_rng, std::map<qs::bitmask, int> &counts) {
+        std::uniform_real_distribution<double> dist(0, 1);
 
-    qs::check_err(n == 0, "compile", "no gates to compile");
+        // a single shot is drawn directly from the amplitudes without building the distribution
+        std::vector<std::pair<std::size_t, int>> sampled;
+        if (run_shots == 1) {
+            sampled.push_back({sample_final(state, final_positions, dist(run_rng)), 1});
+        } else {
+            std::vector<double> probs = qs::_probabilities(state, final_positions, this->n_threads);
+            qs::Sampler sampler(probs);
+            std::vector<int> local_counts = sampler.sample(run_shots, run_rng);
+            for (std::size_t local = 0; local < local_counts.size(); ++local) {
+                if (local_counts[local] > 0) {
+                    sampled.push_back({local, local_counts[local]});
+                }
+            }
+        }
 
-    // reduce qubits into one qubit
-    this->full_qubit = qs::tensor_reduce(this->qubits);
+        for (std::pair<std::size_t, int> &local_count : sampled) {
+            std::size_t local = local_count.first;
+            qs::bitmask bits = reg;
+            for (int j = 0; j < n_final; ++j) {
+                qs::bitmask mask = (qs::bitmask)1 << (this->n_bits - 1 - final_bits[j]);
+                bits = (local >> (n_final - 1 - j)) & 1 ? bits | mask : bits & ~mask;
+            }
+            if (!readout) {
+                counts[bits] += local_count.second;
+                continue;
+            }
+            // every shot is misread independently
+            for (int shot = 0; shot < local_count.second; ++shot) {
+                qs::bitmask read = bits;
+                for (int bit : final_bits) {
+                    int pos = this->n_bits - 1 - bit;
+                    double p = (bits >> pos) & 1 ? p10[bit] : p01[bit];
+                    if (p != 0 && dist(run_rng) < p) {
+                        read ^= (qs::bitmask)1 << pos;
+                    }
+                }
+                ++counts[read];
+            }
+        }
+    };
+
+    auto skipped = [&](qs::Gate &gate, qs::bitmask reg) {
+        return gate.type == qs::GateType::BARRIER || (!gate.condition_bits.empty() && !gate.condition_holds(reg, this->n_bits));
+    };
+    auto stochastic = [](qs::Gate &gate) {
+        return gate.type == qs::GateType::CHANNEL || gate.type == qs::GateType::MEASURE || gate.type == qs::GateType::RESET;
+    };
+    // write outcome of a measurement into the register
+    auto write = [&](qs::bitmask reg, int bit, int value) {
+        qs::bitmask mask = (qs::bitmask)1 << (this->n_bits - 1 - bit);
+        return value ? reg | mask : reg & ~mask;
+    };
 
-    // configure measurements
-    bool all_classical_used = true;
-    for (int bit = 0; bit < this->n_bits; ++bit) {
-        bool found = false;
-        for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
-            if (this->measurement_mapping[qubit] == bit) {
-                found = true;
-                break;
+    std::random_device rd;
+    std::mt19937 rng(rd());
+    std::map<qs::bitmask, int> counts;
+
+    if (this->n_trajectories == 0 || this->prefix_length == this->compiled_gates.size()) {
+        // every level of branches reuses one copy of the state, allocated when it is first needed
+        std::vector<qs::c_vec> copies(this->max_copies);
+        auto copy_of = [&](qs::c_vec &state, int level) -> qs::c_vec & {
+            if (copies[level].empty()) {
+                copies[level] = qs::c_vec(state.size());
             }
+            std::copy(state.begin(), state.end(), copies[level].begin());
+            return copies[level];
+        };
+
+        // shots of a branch which cannot copy its state any more are simulated one by one from it
+        // on the copy of its level, the last shot takes over the state itself
+        auto single = [&](qs::c_vec &state, std::size_t start, int branch_shots, qs::bitmask start_reg, int level) {
+            std::uniform_real_distribution<double> dist(0, 1);
+            for (int shot = 0; shot < branch_shots; ++shot) {
+                qs::c_vec &run_state = shot + 1 < branch_shots ? copy_of(state, level) : state;
+                qs::bitmask reg = start_reg;
+                for (std::size_t i = start; i < this->compiled_gates.size(); ++i) {
+                    qs::Gate &gate = this->compiled_gates[i];
+                    if (skipped(gate, reg)) {
+                        continue;
+                    }
+                    if (!stochastic(gate)) {
+                        gate.apply(run_state, this->n_qubits, this->n_threads);
+                        continue;
+                    }
+
+                    std::vector<double> probs = event_probabilities(gate, kraus[i], run_state, this->n_qubits, this->n_threads);
+                    int outcome = choose_outcome(probs, dist(rng));
+                    apply_outcome(gate, kraus[i], run_state, this->n_qubits, outcome, probs[outcome], this->n_threads);
+                    if (gate.type == qs::GateType::MEASURE) {
+                        int qubit = gate.targets[0];
+                        double p = outcome ? this->readout_p10[qubit] : this->readout_p01[qubit];
+                        reg = write(reg, gate.bit, p != 0 && dist(rng) < p ? 1 - outcome : outcome);
+                    }
+                }
+                record(run_state, reg, 1, rng, counts);
+            }
+        };
+
+        // shots are split among the outcomes of every channel and measurement by a multinomial draw
+        // and every branch with at least one shot is simulated once, depth first, with all threads updating its state
+        // the branch with the most shots takes over the state, the others work on the copy of their level
+        // and once all copies are held, the remaining shots of the branch are simulated one by one
+        std::function<void(qs::c_vec &, std::size_t, int, qs::bitmask, int)> branch = [&](qs::c_vec &state, std::size_t start, int branch_shots, qs::bitmask reg, int level) {
+            for (std::size_t i = start; i < this->compiled_gates.size(); ++i) {
+                qs::Gate &gate = this->compiled_gates[i];
+                if (skipped(gate, reg)) {
+                    continue;
+                }
+                if (!stochastic(gate)) {
+                    gate.apply(state, this->n_qubits, this->n_threads);
+                    continue;
+                }
+
+                std::vector<double> probs = event_probabilities(gate, kraus[i], state, this->n_qubits, this->n_threads);
+                qs::Sampler sampler(probs);
+                std::vector<int> outcome_shots = sampler.sample_multinomial(branch_shots, rng);
+
+                // children as outcome, register and number of shots, a misread measurement changes only the register
+                std::vector<std::tuple<int, qs::bitmask, int>> children;
+                for (int outcome = 0; outcome < outcome_shots.size(); ++outcome) {
+                    if (outcome_shots[outcome] == 0) {
+                        continue;
+                    }
+                    if (gate.type != qs::GateType::MEASURE) {
+                        children.push_back({outcome, reg, outcome_shots[outcome]});
+                        continue;
+                    }
+                    int qubit = gate.targets[0];
+                    double p = outcome ? this->readout_p10[qubit] : this->readout_p01[qubit];
+                    std::binomial_distribution<int> binomial(outcome_shots[outcome], p);
+                    int misread = p == 0 ? 0 : binomial(rng);
+                    if (misread > 0) {
+                        children.push_back({outcome, write(reg, gate.bit, 1 - outcome), misread});
+                    }
+                    if (misread < outcome_shots[outcome]) {
+                        children.push_back({outcome, write(reg, gate.bit, outcome), outcome_shots[outcome] - misread});
+                    }
+                }
+
+                // the shots simulated one by one need a copy as well
+                if (children.size() > 1 && level + 1 == this->max_copies) {
+                    single(state, i, branch_shots, reg, level);
+                    return;
+                }
+                // weak noise leaves most shots in one branch, which then never needs a copy
+                std::iter_swap(std::max_element(children.begin(), children.end(), [](const std::tuple<int, qs::bitmask, int> &a, const std::tuple<int, qs::bitmask, int> &b) {
+                    return std::get<2>(a) < std::get<2>(b);
+                }), children.end() - 1);
+                for (std::size_t c = 0; c + 1 < children.size(); ++c) {
+                    qs::c_vec &copy = copy_of(state, level);
+                    int outcome = std::get<0>(children[c]);
+                    apply_outcome(gate, kraus[i], copy, this->n_qubits, outcome, probs[outcome], this->n_threads);
+                    branch(copy, i + 1, std::get<2>(children[c]), std::get<1>(children[c]), level + 1);
+                }
+                int outcome = std::get<0>(children.back());
+                apply_outcome(gate, kraus[i], state, this->n_qubits, outcome, probs[outcome], this->n_threads);
+                reg = std::get<1>(children.back());
+                branch_shots = std::get<2>(children.back());
+            }
+            record(state, reg, branch_shots, rng, counts);
+        };
+        if (shots > 0) {
+            branch(prefix, this->prefix_length, shots, 0, 0);
         }
-        if (!found) {
-            all_classical_used = false;
-            break;
+    } else {
+        // every trajectory has its own seed and share of shots, so the counts do not depend on the number of threads
+        std::size_t n_runs = this->n_trajectories;
+        std::vector<std::uint32_t> seeds(n_runs);
+        for (std::uint32_t &seed : seeds) {
+            seed = rng();
         }
-    }
 
-    qs::check_err(!all_classical_used, "compile", "not all classical bits are used, either remove the extra ones or use them for some qubit");
+        std::size_t chunk = qs::_chunk_size(n_runs, 1);
+        std::vector<std::map<qs::bitmask, int>> partial((n_runs + chunk - 1) / chunk);
+        qs::_parallel_for(n_runs, this->n_threads, [&](std::size_t begin, std::size_t end) {
+            std::uniform_real_distribution<double> dist(0, 1);
+            // the buffer of the state is reused by all trajectories of the chunk
+            qs::c_vec state(prefix.size());
+            for (std::size_t run = begin; run < end; ++run) {
+                std::mt19937 run_rng(seeds[run]);
+                std::copy(prefix.begin(), prefix.end(), state.begin());
+                // classical register written by mid-circuit measurements
+                qs::bitmask reg = 0;
+                for (std::size_t i = this->prefix_length; i < this->compiled_gates.size(); ++i) {
+                    qs::Gate &gate = this->compiled_gates[i];
+                    if (skipped(gate, reg)) {
+                        continue;
+                    }
+                    if (!stochastic(gate)) {
+                        gate.apply(state, this->n_qubits);
+                        continue;
+                    }
+
+                    std::vector<double> probs = event_probabilities(gate, kraus[i], state, this->n_qubits, 1);
+                    int outcome = choose_outcome(probs, dist(run_rng));
+                    apply_outcome(gate, kraus[i], state, this->n_qubits, outcome, probs[outcome], 1);
+                    if (gate.type == qs::GateType::MEASURE) {
+                        int qubit = gate.targets[0];
+                        double p = outcome ? this->readout_p10[qubit] : this->readout_p01[qubit];
+                        reg = write(reg, gate.bit, p != 0 && dist(run_rng) < p ? 1 - outcome : outcome);
+                    }
+                }
+
+                int run_shots = shots / n_runs + (run < shots % n_runs ? 1 : 0);
+                if (run_shots > 0) {
+                    record(state, reg, run_shots, run_rng, partial[begin / chunk]);
+                }
+            }
+        }, 1);
 
-    this->measured_qubits.resize(0);
-    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
-        if (this->measurement_mapping[qubit] != -1) {
-            this->measured_qubits.push_back(qubit);
+        for (std::map<qs::bitmask, int> &chunk_counts : partial) {
+            for (const std::pair<const qs::bitmask, int> &key_val : chunk_counts) {
+                counts[key_val.first] += key_val.second;
+            }
         }
     }
 
-    this->compiled = true;
+    // probabilities of the outcomes are estimated by their frequencies
+    qs::Results results(shots, this->n_bits);
+    for (const std::pair<const qs::bitmask, int> &key_val : counts) {
+        results.add_sampled(key_val.first, key_val.second, (double)key_val.second / shots);
+    }
+
+    return results;
 }
 
-qs::Unitary qs::QuantumCircuit::to_gate() {
-    qs::check_err(this->gates.empty(), "to_gate", "circuit has no gates");
+// matrix of the gate on its qubits sorted in increasing order, the first one being the most significant bit
+static qs::c_mat local_matrix(qs::Gate &gate, std::vector<int> &sorted) {
+    qs::Gate local = gate;
+    for (int &qubit : local.targets) {
+        qubit = std::lower_bound(sorted.begin(), sorted.end(), qubit) - sorted.begin();
+    }
+    for (int &qubit : local.controls) {
+        qubit = std::lower_bound(sorted.begin(), sorted.end(), qubit) - sorted.begin();
+    }
+    qs::Unitary matrix = local.expand(sorted.size());
+    matrix.to_dense();
+    return matrix.items;
+}
 
-    int n = this->gates.size();
+qs::Results qs::QuantumCircuit::run_mps(int shots, bool verbose) {
+    qs::Mps mps(this->n_qubits, this->max_bond, this->mps_cutoff);
+    for (int q = 0; q < this->n_qubits; ++q) {
+        mps.set_qubit(q, this->qubits[q].items[0], this->qubits[q].items[1]);
+    }
 
-    qs::Unitary gate;
-    bool first = true;
+    if (verbose)
+        std::cout << "Steps of the circuit [" << "G is applied gate, B are bond dimensions in a step" << "]:" << std::endl;
 
-    for (int i = n - 1; i >= 0; --i) {
-        if (this->gates[i].dim != 0) {
-            if (first) {
-                gate = this->gates[i];
-                first = false;
+    int k = 0;
+    for (qs::Gate &gate : this->compiled_gates) {
+        if (verbose) {
+            std::cout << "$ (" << k++ << ") ";
+            if (gate.type == qs::GateType::BARRIER) {
+                std::cout << "B:";
+                std::vector<int> bonds = mps.bond_dimensions();
+                for (int q = 1; q < this->n_qubits; ++q) {
+                    std::cout << " " << bonds[q];
+                }
             } else {
-                gate = gate % this->gates[i];
+                std::cout << "G: ";
+                gate.symbol();
             }
+            std::cout << std::endl;
+        }
+        if (gate.type == qs::GateType::BARRIER) {
+            continue;
         }
+
+        std::vector<int> sorted = gate.qubits();
+        std::sort(sorted.begin(), sorted.end());
+        qs::c_mat matrix = local_matrix(gate, sorted);
+        mps.apply(matrix, sorted);
     }
+    mps.canonicalize();
 
-    return gate;
-}
+    // qubit measured into every classical bit, all sites up to the last measured one are sampled
+    std::vector<int> bit_qubits(this->n_bits);
+    int last = -1;
+    for (int qubit = 0; qubit < this->n_qubits; ++qubit) {
+        if (this->measurement_mapping[qubit] != -1) {
+            bit_qubits[this->measurement_mapping[qubit]] = qubit;
+            last = qubit;
+        }
+    }
 
-void qs::QuantumCircuit::_generate_projections(std::vector<std::vector<qs::BasicQubits>> &projections, std::vector<qs::BasicQubits> &basic_qubits, std::vector<qs::BasicQubits> basis) {
-    if (basis.size() == n_qubits) {
-        projections.push_back(basis);
-        return;
+    // every shot is an independent sample of the sites, shots are split among threads with their own seeds
+    std::random_device rd;
+    std::mt19937 rng(rd());
+    // the chain may hold many more qubits than a bitmask, so the outcomes are kept as bit strings
+    std::map<std::string, int> counts;
+    if (shots > 0 && last == -1) {
+        counts[std::string(this->n_bits, '0')] = shots;
+    } else if (shots > 0) {
+        std::size_t chunk = qs::_chunk_size(shots, 16);
+        std::size_t n_chunks = (shots + chunk - 1) / chunk;
+        std::vector<std::uint32_t> seeds(n_chunks);
+        for (std::uint32_t &seed : seeds) {
+            seed = rng();
+        }
+        std::vector<std::map<std::string, int>> partial(n_chunks);
+        qs::_parallel_for(shots, this->n_threads, [&](std::size_t begin, std::size_t end) {
+            std::mt19937 chunk_rng(seeds[begin / chunk]);
+            for (std::size_t shot = begin; shot < end; ++shot) {
+                std::vector<int> outcomes = mps.sample(last, chunk_rng);
+                std::string bits(this->n_bits, '0');
+                for (int bit = 0; bit < this->n_bits; ++bit) {
+                    if (outcomes[bit_qubits[bit]]) {
+                        bits[bit] = '1';
+                    }
+                }
+                ++partial[begin / chunk][bits];
+            }
+        }, 16);
+        for (std::map<std::string, int> &chunk_counts : partial) {
+            for (const std::pair<const std::string, int> &key_val : chunk_counts) {
+                counts[key_val.first] += key_val.second;
+            }
+        }
+    }
+
+    // exact marginal probability of every sampled outcome, unmeasured sites are traced out
+    std::vector<std::string> sampled;
+    for (const std::pair<const std::string, int> &key_val : counts) {
+        sampled.push_back(key_val.first);
     }
+    std::vector<double> probs(sampled.size(), 1);
+    qs::_parallel_for(sampled.size(), this->n_threads, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::vector<int> outcomes(last + 1, -1);
+            for (int bit = 0; bit < this->n_bits; ++bit) {
+                outcomes[bit_qubits[bit]] = sampled[i][bit] == '1';
+            }
+            probs[i] = mps.probability(outcomes);
+        }
+    }, 1);
 
-    for (qs::BasicQubits &basic_qubit : basic_qubits) {
-        basis.push_back(basic_qubit);
-        qs::QuantumCircuit::_generate_projections(projections, basic_qubits, basis);
-        basis.pop_back();
+    qs::Results results(shots, this->n_bits);
+    for (std::size_t i = 0; i < sampled.size(); ++i) {
+        results.add_sampled(sampled[i], counts[sampled[i]], probs[i]);
     }
+    results.set_truncation_error(mps.truncation_error());
+
+    return results;
 }
 
-qs::Results qs::QuantumCircuit::run(int shots, bool verbose) {
-    qs::check_err(!this->compiled, "run", "circuit was not compiled");
+qs::c_vec qs::QuantumCircuit::final_state() {
+    this->bind_gates();
 
-    qs::Ket ket_res = this->full_qubit;
-    int n = this->gates.size();
+    qs::c_vec state = this->initial_state().items;
+    for (qs::Gate &gate : this->compiled_gates) {
+        gate.apply(state, this->n_qubits, this->n_threads);
+    }
+    return state;
+}
 
-    if (verbose)
-        std::cout << "Steps of the circuit [" << "G is applied gate, Q is state vector in a step" << "]:" << std::endl;
+double qs::QuantumCircuit::expectation(qs::PauliSum &observable) {
+    qs::check_err(!this->compiled, "expectation", "circuit was not compiled");
+    qs::check_dims("expectation", observable.n_qubits, this->n_qubits);
+    qs::check_err(this->compiled_backend == qs::Backend::MPS || this->compiled_backend == qs::Backend::TRAJECTORIES, "expectation", "expectation values need the state vector, the density matrix or the stabilizer tableau");
 
-    int k = 0;
-    for (qs::Unitary &gate : this->gates) {
-        if (verbose) {
-            std::cout << "$ (" << k++ << ") ";
-            if (gate.dim == 0) {
-                std::cout << "Q: ";
-                ket_res.vector();
-                std::cout << std::endl;
-            } else {
-                std::cout << "G: ";
-                gate.symbol();
-                std::cout << std::endl;
+    // every Pauli string has value 0 or +-1 on a stabilizer state, which is read from the tableau without any amplitudes
+    if (this->compiled_backend == qs::Backend::STABILIZER) {
+        qs::Tableau tableau(this->n_qubits);
+        for (qs::TableauOp &op : this->clifford_prepare_ops) {
+            tableau.apply(op);
+        }
+        for (std::vector<qs::TableauOp> &ops : this->clifford_gate_ops) {
+            for (qs::TableauOp &op : ops) {
+                tableau.apply(op);
             }
         }
+        double value = 0;
+        for (qs::PauliTerm &term : observable.terms) {
+            value += term.coefficient * tableau.expectation(term.paulis);
+        }
+        return value;
+    }
+
+    if (this->compiled_backend == qs::Backend::DENSITY_MATRIX) {
+        this->bind_gates();
+        qs::c_vec rho = qs::_density_matrix(this->full_qubit.items, this->n_threads);
+        for (qs::Gate &gate : this->compiled_gates) {
+            gate.apply(rho, 2 * this->n_qubits, this->n_threads);
+        }
+        return observable.density_expectation(rho);
+    }
+
+    qs::c_vec state = this->final_state();
+    return observable.expectation(state, this->n_threads);
+}
+
+// inverse of a gate applied by the same local kernel, function gates are their own inverse
+static qs::Gate adjoint(qs::Gate &gate) {
+    if (gate.type != qs::GateType::UNITARY) {
+        return gate;
+    }
+    qs::Gate inverse(~gate.matrix, gate.targets, gate.controls);
+    inverse.classify();
+    return inverse;
+}
 
-        if (gate.dim != 0) {
-            ket_res = gate * ket_res;
+// derivative of a parameterized gate by the symbol, controls are part of its matrix since it is zero where they are not |1>
+static qs::Gate derivative_gate(qs::Gate &gate, std::map<std::string, double> &values, std::string name) {
+    qs::c_mat d = gate.matrix.derivative(values, name);
+    int dim = gate.matrix.dim;
+    int full_dim = dim << gate.controls.size();
+    int offset = full_dim - dim;
+
+    qs::c_mat full(full_dim);
+    for (int r = 0; r < dim; ++r) {
+        for (int c = 0; c < dim; ++c) {
+            full[offset + r][offset + c] = d[r][c];
         }
     }
+    qs::Gate derivative(qs::Unitary(full_dim, full, "d" + gate.matrix.label), gate.qubits());
+    derivative.classify();
+    return derivative;
+}
+
+double qs::QuantumCircuit::gradient(qs::PauliSum &observable, std::map<std::string, double> &gradients) {
+    qs::check_err(!this->compiled, "gradient", "circuit was not compiled");
+    qs::check_dims("gradient", observable.n_qubits, this->n_qubits);
+    qs::check_err(this->compiled_backend != qs::Backend::STATE_VECTOR && this->compiled_backend != qs::Backend::SPARSE && this->compiled_backend != qs::Backend::STABILIZER, "gradient", "gradients need a noiseless circuit simulated by the state vector");
 
-    qs::Bra bra_res = ket_res.conjugate();
+    gradients.clear();
+    for (std::string &name : this->parameters()) {
+        gradients[name] = 0;
+    }
 
-    qs::Results results(shots);
+    // circuits on the tableau have no parameterized gates, so only the value is computed and without amplitudes
+    if (this->compiled_backend == qs::Backend::STABILIZER) {
+        return this->expectation(observable);
+    }
 
-    // generate all projections
-    std::vector<qs::BasicQubits> basic_qubits = {qs::BasicQubits::ZERO, qs::BasicQubits::ONE};
-    std::vector<std::vector<qs::BasicQubits>> all_projection_bases;
-    qs::QuantumCircuit::_generate_projections(all_projection_bases, basic_qubits);
+    // forward pass, lambda = O |psi> carries the observable back through the gates
+    qs::c_vec psi = this->final_state();
+    qs::c_vec lambda = observable.apply(psi, this->n_threads);
+    double value = qs::_real_overlap(psi, lambda, this->n_threads);
 
-    // for every projection basis
-    for (std::vector<qs::BasicQubits> &projection_basis : all_projection_bases) {
-        // compute projection matrix
-        qs::Unitary proj = qs::Proj(projection_basis);
-        // compute probability of measurement
-        double p = (bra_res * proj * ket_res).magnitude();
-        // determine bits of measured qubit
-        std::string bits = qs::Outcome::get_bits(projection_basis, this->measured_qubits, this->measurement_mapping);
-        // add the outcome or increase its probability
-        results.add_outcome(bits, p);
+    if (gradients.empty()) {
+        return value;
     }
 
-    // conduct experiment on the outcomes
-    results.run();
+    // backward pass, before gate i psi is the state before it and lambda is O |psi> moved back after it
+    // so d<O>/dtheta = 2 Re <lambda| dU_i/dtheta |psi>
+    for (std::size_t i = this->compiled_gates.size(); i-- > 0;) {
+        qs::Gate &gate = this->compiled_gates[i];
+        if (gate.type == qs::GateType::BARRIER) {
+            continue;
+        }
 
-    return results;
+        qs::Gate inverse = adjoint(gate);
+        inverse.apply(psi, this->n_qubits, this->n_threads);
+
+        if (gate.is_parametric()) {
+            std::vector<std::string> names;
+            for (qs::Parameter &parameter : gate.matrix.parameters) {
+                if (parameter.is_symbol() && std::find(names.begin(), names.end(), parameter.name) == names.end()) {
+                    names.push_back(parameter.name);
+                }
+            }
+            for (std::string &name : names) {
+                qs::c_vec mu = psi;
+                derivative_gate(gate, this->parameter_values, name).apply(mu, this->n_qubits, this->n_threads);
+                gradients[name] += 2 * qs::_real_overlap(lambda, mu, this->n_threads);
+            }
+        }
+
+        inverse.apply(lambda, this->n_qubits, this->n_threads);
+    }
+
+    return value;
 }
 
 void qs::QuantumCircuit::show() {
@@ -250,8 +1573,32 @@ void qs::QuantumCircuit::show() {
         }
         std::cout << prefix << std::endl;
         std::cout << prefix << "Gates:" << std::endl;
-        for (qs::Unitary &gate : this->gates) {
-            if (gate.dim == 0) {
+        for (qs::Gate &gate : this->gates) {
+            if (gate.type == qs::GateType::BARRIER) {
+                std::cout << prefix << "--- barrier ---" << std::endl;
+                continue;
+            }
+            std::cout << prefix;
+            gate.symbol();
+            std::cout << std::endl;
+        }
+    } else if (this->compiled_backend == qs::Backend::MPS) {
+        std::cout << prefix << "Circuit is compiled for the matrix product state backend (max bond " << this->max_bond << ")" << std::endl;
+        std::cout << prefix << "Gates after fusion:" << std::endl;
+        for (qs::Gate &gate : this->compiled_gates) {
+            if (gate.type == qs::GateType::BARRIER) {
+                std::cout << prefix << "--- barrier ---" << std::endl;
+                continue;
+            }
+            std::cout << prefix;
+            gate.symbol();
+            std::cout << std::endl;
+        }
+    } else if (this->compiled_backend == qs::Backend::STABILIZER) {
+        std::cout << prefix << "Circuit is compiled for the stabilizer backend" << std::endl;
+        std::cout << prefix << "Gates:" << std::endl;
+        for (qs::Gate &gate : this->gates) {
+            if (gate.type == qs::GateType::BARRIER) {
                 std::cout << prefix << "--- barrier ---" << std::endl;
                 continue;
             }
@@ -260,15 +1607,24 @@ void qs::QuantumCircuit::show() {
             std::cout << std::endl;
         }
     } else {
-        std::cout << prefix << "Circuit is compiled" << std::endl;
+        std::cout << prefix << "Circuit is compiled";
+        if (this->compiled_backend == qs::Backend::DENSITY_MATRIX) {
+            std::cout << " for the density matrix backend, column qubits of rho are shifted by " << this->n_qubits;
+        }
+        std::cout << std::endl;
         std::cout << prefix << "Qubit: ";
-        this->full_qubit.symbol();
-        std::cout << " = ";
-        this->full_qubit.vector();
+        if (this->compiled_backend == qs::Backend::SPARSE) {
+            qs::print_sparse(this->sparse_qubit, this->n_qubits);
+            std::cout << std::endl;
+        } else {
+            this->full_qubit.symbol();
+            std::cout << " = ";
+            this->full_qubit.vector();
+        }
         std::cout << prefix << std::endl;
-        std::cout << prefix << "Gates:" << std::endl;
-        for (qs::Unitary &gate : this->gates) {
-            if (gate.dim == 0) {
+        std::cout << prefix << "Gates after fusion:" << std::endl;
+        for (qs::Gate &gate : this->compiled_gates) {
+            if (gate.type == qs::GateType::BARRIER) {
                 std::cout << prefix << "--- barrier ---" << std::endl;
                 continue;
             }
@@ -279,20 +1635,12 @@ void qs::QuantumCircuit::show() {
     }
 }
 
-std::string qs::Outcome::get_bits(std::vector<qs::BasicQubits> &basis, std::vector<int> &measured_qubits, std::vector<int> &measurement_mapping) {
-    std::string bits(measured_qubits.size(), '-');
-    for (int m : measured_qubits) {
-        bits[measurement_mapping[m]] = basis[m];
-    }
-    return bits;
-}
-
 void qs::Outcome::add_p(double p) {
     this->p += p;
 }
 
-void qs::Outcome::show() {
-    std::cout << this->bits << " [p=" << this->p << "]" << std::endl;
+void qs::Outcome::show(int n_bits) {
+    std::cout << qs::Results::to_string(this->bits, n_bits) << " [p=" << this->p << "]" << std::endl;
 }
 
 qs::ConstantOracle::ConstantOracle(int n_qubits, int output) : qs::QuantumCircuit(n_qubits) {
@@ -319,14 +1667,10 @@ qs::BalancedOracle::BalancedOracle(int n_qubits) : qs::QuantumCircuit(n_qubits)
 
 qs::SimonOracle::SimonOracle(std::string s) : qs::QuantumCircuit(2 * s.size()) {
     int n = s.size();
-    int two_n = (int)pow(2, n);
-    int four_n = (int)pow(4, n);
-
-    qs::QuantumCircuit c(2 * n, n, qs::BasicQubits::ZERO);
 
     // copy first n qubits to the second n qubits i.e. |x>|0> -> |x>|x>
     for (int i = 0; i < n; ++i) {
-        c.cgate(qs::PauliX(), i, i + n);
+        this->cgate(qs::PauliX(), i, i + n);
     }
 
     // apply CNOT on first occurence of 1 with positions in the second n qubits where 1 is in the secret string
@@ -334,26 +1678,82 @@ qs::SimonOracle::SimonOracle(std::string s) : qs::QuantumCircuit(2 * s.size()) {
     if (flag_bit != std::string::npos) {
         for (int i = 0; i < n; ++i) {
             if (s[i] == '1') {
-                c.cgate(qs::PauliX(), flag_bit, i + n);
+                this->cgate(qs::PauliX(), flag_bit, i + n);
             }
         }
     }
+}
 
-    qs::Unitary gate = c.to_gate();
-    gate.label = "Uf";
-    this->gates.push_back(gate);
+qs::FunctionOracle::FunctionOracle(int n, int m, std::vector<std::size_t> table) : qs::QuantumCircuit(n + m) {
+    this->n_bits = 0;
+
+    std::vector<int> inputs(n);
+    std::vector<int> outputs(m);
+    for (int i = 0; i < n; ++i) {
+        inputs[i] = i;
+    }
+    for (int i = 0; i < m; ++i) {
+        outputs[i] = n + i;
+    }
+
+    this->gates.push_back(qs::Gate(table, inputs, outputs));
+}
+
+// evaluate the function for every input, one call at a time as the callable does not have to be thread-safe
+static std::vector<std::size_t> tabulate(int n, std::function<std::size_t(std::size_t)> &f) {
+    std::vector<std::size_t> table((std::size_t)1 << n);
+    for (std::size_t x = 0; x < table.size(); ++x) {
+        table[x] = f(x);
+    }
+    return table;
 }
 
-qs::Results::Results(int shots) {
+qs::FunctionOracle::FunctionOracle(int n, int m, std::function<std::size_t(std::size_t)> f) : qs::FunctionOracle(n, m, tabulate(n, f)) {}
+
+qs::Results::Results(int shots, int n_bits) {
     this->shots = shots;
+    this->n_bits = n_bits;
+    this->truncation_error = 0;
     std::random_device rd;
     this->rng = std::mt19937(rd());
-    this->dist = std::uniform_real_distribution<double>(0, 1);
 }
 
-void qs::Results::add_outcome(std::string &bits, double p) {
-    // ignore outcomes that have zero probability
-    if (p == 0) {
+std::string qs::Results::to_string(qs::bitmask bits, int n_bits) {
+    std::string s(n_bits, '0');
+    for (int bit = 0; bit < n_bits; ++bit) {
+        if ((bits >> (n_bits - 1 - bit)) & 1) {
+            s[bit] = '1';
+        }
+    }
+    return s;
+}
+
+qs::bitmask qs::Results::to_bitmask(std::string &bits) {
+    qs::bitmask mask = 0;
+    for (char bit : bits) {
+        mask = (mask << 1) | (bit == '1' ? 1 : 0);
+    }
+    return mask;
+}
+
+void qs::Results::add_sampled(qs::bitmask bits, int count, double p) {
+    this->outcomes[bits] = Outcome(bits);
+    this->outcomes[bits].add_p(p);
+    this->counts[bits] += count;
+}
+
+void qs::Results::add_sampled(std::string &bits, int count, double p) {
+    if (this->n_bits <= qs::bitmask_bits) {
+        this->add_sampled(qs::Results::to_bitmask(bits), count, p);
+        return;
+    }
+    this->wide_outcomes[bits] = p;
+    this->wide_counts[bits] += count;
+}
+
+void qs::Results::add_outcome(qs::bitmask bits, double p) {
+    // ignore outcomes that have zero probability (up to rounding errors of the simulation)
+    if (p < qs::Results::p_tolerance) {
         return;
     }
     // add the outcome or increase its probability
@@ -365,13 +1765,35 @@ void qs::Results::add_outcome(std::string &bits, double p) {
 
 std::vector<std::string> qs::Results::get_bits() {
     std::vector<std::string> bits;
-    for (const std::pair<const std::string, qs::Outcome> &key_val : this->outcomes) {
+    for (const std::pair<const qs::bitmask, qs::Outcome> &key_val : this->outcomes) {
+        bits.push_back(qs::Results::to_string(key_val.first, this->n_bits));
+    }
+    for (const std::pair<const std::string, double> &key_val : this->wide_outcomes) {
         bits.push_back(key_val.first);
     }
     return bits;
 }
 
+void qs::Results::set_truncation_error(double error) {
+    this->truncation_error = error;
+}
+
+double qs::Results::get_truncation_error() {
+    return this->truncation_error;
+}
+
 double qs::Results::get_measured_ratio(std::string &bits) {
+    if (this->n_bits <= qs::bitmask_bits) {
+        return this->get_measured_ratio(qs::Results::to_bitmask(bits));
+    }
+    if (this->wide_counts.find(bits) == this->wide_counts.end()) {
+        return 0.0;
+    }
+    return (double)this->wide_counts[bits] / this->shots;
+}
+
+double qs::Results::get_measured_ratio(qs::bitmask bits) {
+    qs::check_err(this->n_bits > qs::bitmask_bits, "get_measured_ratio", "outcomes wider than a bitmask are given by their bit strings");
     // the outcome was not sampled at all
     if (this->counts.find(bits) == this->counts.end()) {
         return 0.0;
@@ -380,33 +1802,44 @@ double qs::Results::get_measured_ratio(std::string &bits) {
     return (double)this->counts[bits] / this->shots;
 }
 
-void qs::Results::run() {
+void qs::Results::run(qs::SamplingMethod method) {
     // reset the counts to zeros for each possible outcome
     this->counts.clear();
-    for (const std::pair<const std::string, qs::Outcome> &key_val : this->outcomes) {
-        this->counts[key_val.second.bits] = 0;
-    }
-
-    // sample shots times an outcome based on its probability
-    for (int i = 0; i < this->shots; ++i) {
-        double prob = this->dist(this->rng);
-        double cum_prob = 0.0;
-        for (const std::pair<const std::string, qs::Outcome> &key_val : this->outcomes) {
-            qs::Outcome outcome = key_val.second;
-            cum_prob += outcome.p;
-            if (prob < cum_prob) {
-                this->counts[outcome.bits] += 1;
-                break;
-            }
-        }
+    this->wide_counts.clear();
+    if (this->outcomes.empty() && this->wide_outcomes.empty()) {
+        return;
+    }
+
+    // only one of the maps holds outcomes, depending on the width of the register
+    std::vector<double> probs;
+    for (const std::pair<const qs::bitmask, qs::Outcome> &key_val : this->outcomes) {
+        probs.push_back(key_val.second.p);
+    }
+    for (const std::pair<const std::string, double> &key_val : this->wide_outcomes) {
+        probs.push_back(key_val.second);
+    }
+
+    // build the sampling tables once and draw all shots from them
+    qs::Sampler sampler(probs);
+    std::vector<int> sampled = sampler.sample(this->shots, this->rng, method);
+
+    int i = 0;
+    for (const std::pair<const qs::bitmask, qs::Outcome> &key_val : this->outcomes) {
+        this->counts[key_val.first] = sampled[i++];
+    }
+    for (const std::pair<const std::string, double> &key_val : this->wide_outcomes) {
+        this->wide_counts[key_val.first] = sampled[i++];
     }
 }
 
 void qs::Results::show_outcomes() {
     std::cout << "Outcomes with probability:" << std::endl;
-    for (const std::pair<const std::string, qs::Outcome> &key_val : this->outcomes) {
+    for (const std::pair<const qs::bitmask, qs::Outcome> &key_val : this->outcomes) {
         qs::Outcome outcome = key_val.second;
-        outcome.show();
+        outcome.show(this->n_bits);
+    }
+    for (const std::pair<const std::string, double> &key_val : this->wide_outcomes) {
+        std::cout << key_val.first << " [p=" << key_val.second << "]" << std::endl;
     }
 }
 
@@ -414,21 +1847,24 @@ void qs::Results::show_counts() {
     std::cout << "Measurements: " << std::endl;
     int line_width = 50;
     double unit = (double)line_width / this->shots;
-    int count;
     int filled;
     int nonfilled;
     double percent;
     std::string meter;
     std::string rest;
-    for (const std::pair<const std::string, const int> &key_val : this->counts) {
-        std::string bits = key_val.first;
-        count = key_val.second;
+    auto show_line = [&](const std::string &bits, int count) {
         filled = floor(unit * count);
         nonfilled = line_width - filled;
         meter = std::string(filled, '#');
         rest = std::string(nonfilled, '.');
         percent = (double)count / this->shots * 100;
         std::cout << bits << " |" << meter << rest << "| " << percent << "% (" << count << "/" << this->shots << ")" << std::endl;
+    };
+    for (const std::pair<const qs::bitmask, int> &key_val : this->counts) {
+        show_line(qs::Results::to_string(key_val.first, this->n_bits), key_val.second);
+    }
+    for (const std::pair<const std::string, int> &key_val : this->wide_counts) {
+        show_line(key_val.first, key_val.second);
     }
     std::cout << std::endl;
 }
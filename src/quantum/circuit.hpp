@@ -1,40 +1,164 @@
 #ifndef __CIRCUIT_HPP__
 #define __CIRCUIT_HPP__
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <random>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
+#include "../lib/dm_op.hpp"
+#include "../lib/mps.hpp"
+#include "../lib/sampler.hpp"
+#include "../lib/snapshot.hpp"
 #include "../utils/err.hpp"
 #include "./basis.hpp"
+#include "./clifford.hpp"
+#include "./fusion.hpp"
+#include "./gate.hpp"
+#include "./noise.hpp"
+#include "./pauli.hpp"
 #include "./qubit.hpp"
 #include "./unitary.hpp"
 
 namespace qs {
+    // classical bits of an outcome packed into an integer, the first classical bit is the most significant
+    typedef std::uint64_t bitmask;
+    // number of classical bits which fit into a bitmask, wider registers are kept as bit strings
+    constexpr int bitmask_bits = 64;
+
     class QuantumCircuit;
     class Results;
     class Outcome;
 
+    // simulation method used by a circuit
+    enum class Backend : char {
+        // density matrix for small and trajectories for large noisy circuits, trajectories for mid-circuit measurements,
+        // stabilizer tableau if all gates are clifford gates
+        // and state vector otherwise, which starts sparse if the initial state populates at most sparse_density of the basis states
+        AUTOMATIC = 'a',
+        // dense vector of 2^n amplitudes
+        STATE_VECTOR = 'v',
+        // Aaronson-Gottesman tableau, polynomial in the number of qubits but only for clifford circuits
+        STABILIZER = 't',
+        // only the populated basis states, converted to the dense vector once their fraction exceeds a threshold
+        SPARSE = 's',
+        // vectorized density matrix of 4^n amplitudes, exact for noise channels and readout errors, which trajectories only sample
+        DENSITY_MATRIX = 'd',
+        // pure state vectors of noisy circuits evolved with randomly chosen Kraus operators and measurement outcomes
+        // every trajectory needs only 2^n amplitudes, its final state is sampled for its share of shots
+        // supports noise channels, readout errors and mid-circuit measurements
+        TRAJECTORIES = 'j',
+        // matrix product state with bounded bond dimension, efficient for weakly entangled circuits
+        // such as shallow nearest-neighbour chains, never selected automatically
+        MPS = 'm',
+    };
+
+    // default maximal bond dimension and truncation threshold of the matrix product state backend
+    constexpr int default_max_bond = 256;
+    constexpr double default_mps_cutoff = 1e-16;
+    // largest noisy circuit which is simulated automatically as a density matrix instead of trajectories
+    constexpr int max_density_qubits = 12;
+    // default fraction of populated basis states above which the sparse state is converted to the dense one
+    constexpr double default_sparse_density = 1.0 / 32;
+    // default number of states copied at once by the branches of the trajectory backend
+    constexpr int default_branch_copies = 16;
+
     class QuantumCircuit {
+        // batches copy the template circuit and replace its gates by the state they produce
+        friend class Batch;
+
     protected:
         int n_qubits;
         int n_bits;
         // list of intial qubits in the circuit
         std::vector<Ket> qubits;
+        // state of all qubits which replaces the tensor product of the initial qubits if it is not empty
+        c_vec start_state;
         // list of gates to apply on initial qubits
-        // are stored already in parallel format, i.e. tensor products
-        std::vector<Unitary> gates;
+        // are stored as compact records of small matrices and their target qubits
+        std::vector<Gate> gates;
         // map qubit index to measurement bit index
         std::vector<int> measurement_mapping;
+        // number of threads used to update the state vector
+        int n_threads;
+        // maximal number of qubits of gates merged during compilation
+        int fusion_size;
+        // requested simulation method
+        Backend backend;
+        // maximal bond dimension and relative weight of dropped singular values of the matrix product state backend
+        int max_bond;
+        double mps_cutoff;
+        // fraction of populated basis states above which the sparse state vector is made dense
+        double sparse_density;
+        // noise channels applied to every qubit of every gate
+        std::vector<Channel> gate_channels;
+        // number of independent trajectories of the trajectory backend, 0 branches the shots instead
+        int n_trajectories;
+        // number of states copied at once by the branches, a deeper branch simulates its shots one by one
+        int max_copies;
+        // classical bits and their value on which the inserted gates are conditioned, empty outside of a condition
+        std::vector<int> condition_bits;
+        bitmask condition_value;
+        // probabilities of reading 0 as 1 and 1 as 0 for every qubit
+        std::vector<double> readout_p01;
+        std::vector<double> readout_p10;
+        // values bound to the symbols of parameterized gates
+        std::map<std::string, double> parameter_values;
 
         // variables that are filled during compilation
         bool compiled;
-        // tensor product of initial qubits
+        // simulation method selected during compilation
+        Backend compiled_backend;
+        // tensor product of initial qubits, built only for the state vector backend
         Ket full_qubit;
+        // populated basis states of the tensor product of initial qubits, built only for the sparse backend
+        SparseVec sparse_qubit;
+        // gates after fusion which are applied by run
+        std::vector<Gate> compiled_gates;
+        // number of compiled gates before the first channel or mid-circuit measurement, which are applied once for all trajectories
+        std::size_t prefix_length;
+        // tableau operations preparing the initial qubits and operations of every gate for the stabilizer backend
+        std::vector<TableauOp> clifford_prepare_ops;
+        std::vector<std::vector<TableauOp>> clifford_gate_ops;
+        // the compiled parameterized gates hold the currently bound values
+        bool bound;
         // list of measured qubits
         std::vector<int> measured_qubits;
+        // bit positions in the state index of qubits measured into classical bits 0, 1, ... at the end of the circuit
+        std::vector<int> measured_bits;
+
+        // insert gate under the current condition
+        void add_gate(Gate gate);
+        // normalized initial state of all qubits as a single ket
+        Ket initial_state();
+        // recompute the matrices of compiled parameterized gates if some value changed since the last run
+        void bind_gates();
+        // state vector after all gates of a circuit on the state vector or the sparse backend
+        c_vec final_state();
+
+        // check if the circuit contains noise channels or readout errors
+        bool is_noisy();
+        // check if the circuit contains mid-circuit measurements, resets or conditioned gates
+        bool is_dynamic();
+        // check if some barrier writes the state to a file
+        bool has_snapshots();
+        // gates with the channels of gate_noise inserted after every gate
+        std::vector<Gate> noisy_gates();
+
+        // run the experiment on the density matrix of 2n qubits
+        Results run_density(int shots, bool verbose);
+        // run the experiment as trajectories of pure states, either branched by shots or independent ones distributed among threads
+        Results run_trajectories(int shots, bool verbose);
+        // run the experiment on the stabilizer tableau, every shot is measured separately in O(n^2)
+        Results run_stabilizer(int shots, bool verbose);
+        // run the experiment on the matrix product state, every shot is sampled site by site
+        Results run_mps(int shots, bool verbose);
 
     public:
         QuantumCircuit(std::vector<Ket> &qubits) : QuantumCircuit(qubits, qubits.size()){};
@@ -42,25 +166,78 @@ namespace qs {
         QuantumCircuit(int n_qubits, BasicQubits basis = BasicQubits::ZERO) : QuantumCircuit(n_qubits, n_qubits, basis){};
         QuantumCircuit(int n_qubits, int n_bits, BasicQubits basis = BasicQubits::ZERO);
 
+        // start from the given state of all qubits instead of the tensor product of the initial qubits
+        // such a circuit is simulated by the state vector, trajectories or the density matrix
+        void set_state(Ket state);
+
         // insert barrier which is used for printing intermediate results
         void barrier();
+        // insert barrier which writes the state vector to the file whenever a run reaches it, replacing the previous snapshot
+        // supported by the state vector and sparse backends
+        void snapshot(std::string path);
+        // continue from a snapshot written by this circuit, the state is loaded and the gates before the snapshot are removed
+        // the circuit has to be built in the same way as the one which wrote the snapshot
+        void resume(std::string path);
 
         // insert gate for a single qubit
         void gate(Unitary gate, int qubit);
         // insert the same gate for qubits in parallel
+        // or a multi-qubit gate acting jointly on the given qubits if its dimension matches
         void gate(Unitary gate, std::vector<int> qubits);
         // insert gate for every qubit
         void gate(Unitary gate);
         // insert controlled gate with control and target qubits
         void cgate(Unitary gate, int control, int target);
-        // insert oracle converted into a gate
+        // insert gate controlled by all control qubits, applied to the targets in the same way as gate()
+        void cgate(Unitary gate, std::vector<int> controls, std::vector<int> targets);
+        // insert gates of the oracle circuit
         void oracle(qs::QuantumCircuit oracle);
 
-        // add measurement of qubit into classical bit
+        // insert noise channel acting on a single qubit
+        void noise(Channel channel, int qubit);
+        // insert the same channel for qubits in parallel
+        // or a multi-qubit channel acting jointly on the given qubits if its dimension matches
+        void noise(Channel channel, std::vector<int> qubits);
+        // apply single-qubit channel to every qubit of every gate right after the gate
+        void gate_noise(Channel channel);
+        // set probabilities of reading 0 as 1 and 1 as 0 when measuring the qubit or all qubits
+        void readout_error(int qubit, double p01, double p10);
+        void readout_error(double p01, double p10);
+
+        // add measurement of qubit into classical bit at the end of the circuit
         void measure(int qubit, int bit);
+        // measure qubit into classical bit in the middle of the circuit, the state collapses and the qubit can be used further
+        void mid_measure(int qubit, int bit);
+        // set qubit to |0> in the middle of the circuit
+        void reset(int qubit);
+        // apply gates inserted until end_condition only if the classical bits hold the value, the first bit is the most significant
+        void condition(int bit, int value = 1);
+        void condition(std::vector<int> bits, bitmask value);
+        void end_condition();
 
-        // recursive function to generate all variations of basis qubits of length n_qubits
-        void _generate_projections(std::vector<std::vector<BasicQubits>> &projections, std::vector<qs::BasicQubits> &basic_qubits, std::vector<qs::BasicQubits> basis = {});
+        // bind value to the symbol of parameterized gates, the compiled circuit is kept and only the matrices of its gates change
+        void bind(std::string name, double value);
+        void bind(std::map<std::string, double> values);
+        // names of all symbols in the order of their first use
+        std::vector<std::string> parameters();
+
+        // set number of threads used by run, results do not depend on it
+        void set_threads(int n_threads);
+        // set maximal number of qubits of fused gates, 0 disables the fusion
+        void set_fusion(int max_qubits);
+        // set simulation method, the automatic one is used by default
+        void set_backend(Backend backend);
+        // simulation method selected by compile
+        Backend get_backend();
+        // set bond dimension cap and truncation threshold of the matrix product state backend
+        void set_mps(int max_bond, double cutoff = default_mps_cutoff);
+        // set fraction of populated basis states above which the sparse state vector is converted to the dense one
+        void set_sparse(double density);
+        // set number of independent trajectories among which the shots are split
+        // 0 (default) simulates the shots together and splits them among the outcomes of every channel and measurement
+        void set_trajectories(int n_trajectories);
+        // set number of state copies held at once by the branching shots, which bounds their memory
+        void set_branching(int max_copies);
 
         // prepare the initial qubits and gates for the computation
         void compile();
@@ -70,6 +247,13 @@ namespace qs {
 
         // run the experiment
         Results run(int shots, bool verbose = false);
+        // exact expectation value of the observable in the state before the final measurements, nothing is sampled
+        // noisy circuits give Tr(O rho) on the density matrix, clifford circuits read every Pauli string from the tableau
+        // trajectories and matrix product states are not supported
+        double expectation(PauliSum &observable);
+        // expectation value of the observable and its derivatives by all symbols by the adjoint method
+        // one pass forward and one backward over the gates, only for noiseless circuits without mid-circuit measurements
+        double gradient(PauliSum &observable, std::map<std::string, double> &gradients);
 
         // show the circuit based on if it was compiled or not
         void show();
@@ -91,44 +275,74 @@ namespace qs {
         SimonOracle(std::string s);
     };
 
+    // oracle |x>|y> -> |x>|y xor f(x)> of a classical function f: {0,1}^n -> {0,1}^m acting on n + m qubits
+    // the first n qubits hold x and the last m qubits hold y, the first qubit of both is the most significant bit
+    // the oracle is applied as a permutation of amplitudes without building any matrix
+    class FunctionOracle : public QuantumCircuit {
+    public:
+        // function given by a packed truth table, table[x] holds the m bits of f(x)
+        FunctionOracle(int n, int m, std::vector<std::size_t> table);
+        // function given by a callable which is evaluated once for every input
+        FunctionOracle(int n, int m, std::function<std::size_t(std::size_t)> f);
+    };
+
     class Outcome {
     public:
         Outcome(){};
-        Outcome(std::string &bits) : bits(bits), p(0.0){};
-
-        // encode vector of basis qubits into classical bits
-        static std::string get_bits(std::vector<BasicQubits> &basis, std::vector<int> &measured_qubits, std::vector<int> &measurement_mapping);
+        Outcome(bitmask bits) : bits(bits), p(0.0){};
 
         // outcome is a list of classical bits measured with a probability distribution
-        std::string bits;
-        // probability of measuring 1
+        bitmask bits;
+        // probability of measuring the outcome
         double p;
 
         // add measured probability p
         void add_p(double p);
 
-        void show();
+        void show(int n_bits);
     };
 
     class Results {
     private:
         std::mt19937 rng;
-        std::uniform_real_distribution<double> dist;
 
-        std::unordered_map<std::string, Outcome> outcomes;
-        std::unordered_map<std::string, int> counts;
+        std::map<bitmask, Outcome> outcomes;
+        std::map<bitmask, int> counts;
+        // probabilities and counts of registers wider than a bitmask keyed by their bit strings
+        std::map<std::string, double> wide_outcomes;
+        std::map<std::string, int> wide_counts;
         int shots;
+        int n_bits;
+        // weight of the state discarded by truncation of the matrix product state, zero for exact backends
+        double truncation_error;
 
     public:
-        Results(int shots);
+        // outcomes with smaller probability are considered impossible
+        static constexpr double p_tolerance = 1e-12;
+
+        Results(int shots, int n_bits);
 
-        void add_outcome(std::string &bits, double p);
+        // convert packed classical bits into a bit string and back
+        static std::string to_string(bitmask bits, int n_bits);
+        static bitmask to_bitmask(std::string &bits);
+
+        void add_outcome(bitmask bits, double p);
+        // record outcome sampled count times outside of run together with its exact probability p
+        void add_sampled(bitmask bits, int count, double p);
+        // record outcome given as a bit string, which is the only form of registers wider than a bitmask
+        void add_sampled(std::string &bits, int count, double p);
 
         std::vector<std::string> get_bits();
 
+        void set_truncation_error(double error);
+        double get_truncation_error();
+
         double get_measured_ratio(std::string &bits);
+        // only for registers which fit into a bitmask
+        double get_measured_ratio(bitmask bits);
 
-        void run();
+        // sample shots from the outcome distribution
+        void run(SamplingMethod method = SamplingMethod::AUTOMATIC);
 
         void show_outcomes();
         void show_counts();
@@ -0,0 +1,180 @@
+#include "./clifford.hpp"
+
+// element of the single-qubit clifford group with its shortest decomposition into elementary operations
+struct Clifford1q {
+    qs::c_mat matrix;
+    std::string word;
+};
+
+static qs::c_mat multiply(qs::c_mat &a, qs::c_mat &b) {
+    qs::c_mat c(2);
+    for (int r = 0; r < 2; ++r) {
+        for (int k = 0; k < 2; ++k) {
+            c[r][0] += a[r][k] * b[k][0];
+            c[r][1] += a[r][k] * b[k][1];
+        }
+    }
+    return c;
+}
+
+static double norm2(const qs::Complex &x) {
+    return x.Re * x.Re + x.Im * x.Im;
+}
+
+// check if a = e^{i phi} b for the first column only or for the whole matrix
+static bool equal_up_to_phase(qs::c_mat &a, qs::c_mat &b, int columns, double tolerance) {
+    // the phase is read from the largest entry of b
+    int r_max = 0;
+    int c_max = 0;
+    for (int r = 0; r < 2; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            if (norm2(b[r][c]) > norm2(b[r_max][c_max])) {
+                r_max = r;
+                c_max = c;
+            }
+        }
+    }
+    qs::Complex ratio = a[r_max][c_max] * qs::Complex(b[r_max][c_max].Re, -b[r_max][c_max].Im);
+    double scale = norm2(b[r_max][c_max]);
+    for (int r = 0; r < 2; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            qs::Complex diff = a[r][c] * qs::Complex(scale) - ratio * b[r][c];
+            if (norm2(diff) > tolerance * tolerance * scale * scale) {
+                return false;
+            }
+        }
+    }
+    // the phase has to be a unit complex number
+    return scale > 0 && fabs(sqrt(norm2(ratio)) - scale) <= tolerance * scale;
+}
+
+static qs::c_mat elementary(char gate) {
+    switch (gate) {
+        case 'h':
+            return qs::Hadamard().items;
+        case 's':
+            return qs::c_mat{{qs::Complex(1), qs::Complex(0)}, {qs::Complex(0), qs::Complex(0, 1)}};
+        case 'x':
+            return qs::PauliX().items;
+        case 'y':
+            return qs::PauliY().items;
+        default:
+            return qs::PauliZ().items;
+    }
+}
+
+// all 24 single-qubit cliffords found by breadth-first search over words of elementary operations
+static std::vector<Clifford1q> &clifford_group() {
+    static std::vector<Clifford1q> group;
+    if (!group.empty()) {
+        return group;
+    }
+
+    group.push_back(Clifford1q{qs::Identity().items, ""});
+    for (int i = 0; i < group.size(); ++i) {
+        for (char gate : std::string("xyzhs")) {
+            // the operation is applied after the word, so its matrix multiplies from the left
+            qs::c_mat m = elementary(gate);
+            qs::c_mat product = multiply(m, group[i].matrix);
+            bool found = false;
+            for (Clifford1q &element : group) {
+                if (equal_up_to_phase(product, element.matrix, 2, 1e-9)) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                group.push_back(Clifford1q{product, group[i].word + gate});
+            }
+        }
+    }
+    return group;
+}
+
+static void append_word(std::string &word, int q, std::vector<qs::TableauOp> &ops) {
+    for (char gate : word) {
+        ops.push_back(qs::TableauOp{gate, q, -1});
+    }
+}
+
+bool qs::clifford_ops(qs::Gate &gate, std::vector<qs::TableauOp> &ops, double tolerance) {
+    if (gate.type == qs::GateType::BARRIER) {
+        return true;
+    }
+    // parameterized gates may take any angle after the compilation
+    if (gate.type != qs::GateType::UNITARY || gate.targets.size() != 1 || gate.controls.size() > 1 || gate.is_parametric()) {
+        return false;
+    }
+
+    int target = gate.targets[0];
+
+    if (gate.controls.empty()) {
+        for (Clifford1q &element : clifford_group()) {
+            if (equal_up_to_phase(gate.matrix.items, element.matrix, 2, tolerance)) {
+                append_word(element.word, target, ops);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // controlled Pauli gates, the phase of the controlled matrix matters
+    int control = gate.controls[0];
+    for (char pauli : std::string("xyz")) {
+        qs::c_mat m = elementary(pauli);
+        bool equal = true;
+        for (int r = 0; r < 2; ++r) {
+            for (int c = 0; c < 2; ++c) {
+                equal = equal && norm2(gate.matrix.items[r][c] - m[r][c]) <= tolerance * tolerance;
+            }
+        }
+        if (!equal) {
+            continue;
+        }
+        switch (pauli) {
+            case 'x':
+                ops.push_back(qs::TableauOp{'c', control, target});
+                break;
+            case 'y':
+                // CY = S CX S^dagger on the target
+                ops.push_back(qs::TableauOp{'z', target, -1});
+                ops.push_back(qs::TableauOp{'s', target, -1});
+                ops.push_back(qs::TableauOp{'c', control, target});
+                ops.push_back(qs::TableauOp{'s', target, -1});
+                break;
+            default:
+                // CZ = H CX H on the target
+                ops.push_back(qs::TableauOp{'h', target, -1});
+                ops.push_back(qs::TableauOp{'c', control, target});
+                ops.push_back(qs::TableauOp{'h', target, -1});
+                break;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool qs::clifford_prepare(qs::Ket &qubit, int q, std::vector<qs::TableauOp> &ops, double tolerance) {
+    if (qubit.dim != 2) {
+        return false;
+    }
+
+    qs::c_mat state(2);
+    state[0][0] = qubit.items[0];
+    state[1][0] = qubit.items[1];
+    double norm = sqrt(norm2(state[0][0]) + norm2(state[1][0]));
+    if (norm == 0) {
+        return false;
+    }
+    state[0][0] = state[0][0] * qs::Complex(1 / norm);
+    state[1][0] = state[1][0] * qs::Complex(1 / norm);
+
+    // the first column of a clifford is the state it prepares from |0>
+    for (Clifford1q &element : clifford_group()) {
+        if (equal_up_to_phase(state, element.matrix, 1, tolerance)) {
+            append_word(element.word, q, ops);
+            return true;
+        }
+    }
+    return false;
+}
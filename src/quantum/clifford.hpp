@@ -0,0 +1,21 @@
+#ifndef __CLIFFORD_HPP__
+#define __CLIFFORD_HPP__
+
+#include <vector>
+
+#include "../lib/tableau.hpp"
+#include "./gate.hpp"
+#include "./qubit.hpp"
+
+namespace qs {
+
+    // decompose gate into elementary operations of the tableau and append them to ops
+    // single-qubit cliffords and CX, CY, CZ gates are recognized, returns false for any other gate
+    bool clifford_ops(Gate &gate, std::vector<TableauOp> &ops, double tolerance = 1e-12);
+
+    // append operations which prepare the single-qubit state from |0> on qubit q
+    // returns false if the state is not one of |0>, |1>, |+>, |->, |+i>, |-i> up to a global phase
+    bool clifford_prepare(Ket &qubit, int q, std::vector<TableauOp> &ops, double tolerance = 1e-12);
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "./fusion.hpp"
+
+// gates collected so far for a single fused gate together with the qubits they act on
+struct Block {
+    std::vector<int> qubits;
+    std::vector<qs::Gate> gates;
+};
+
+static bool overlaps(std::vector<int> &a, std::vector<int> &b) {
+    for (int qubit : a) {
+        if (std::find(b.begin(), b.end(), qubit) != b.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void add_qubits(std::vector<int> &qubits, std::vector<int> &other) {
+    for (int qubit : other) {
+        if (std::find(qubits.begin(), qubits.end(), qubit) == qubits.end()) {
+            qubits.push_back(qubit);
+        }
+    }
+}
+
+// convert the block into a single gate and append it unless it is an identity
+static void emit(Block &block, std::vector<qs::Gate> &fused) {
+    if (block.gates.size() == 1) {
+        fused.push_back(block.gates[0]);
+        return;
+    }
+
+    std::sort(block.qubits.begin(), block.qubits.end());
+    qs::Gate gate = qs::merge_gates(block.gates, block.qubits);
+    if (!gate.is_identity()) {
+        fused.push_back(gate);
+    }
+}
+
+std::vector<qs::Gate> qs::fuse_gates(std::vector<qs::Gate> &gates, int max_qubits) {
+    qs::check_err(max_qubits < 0, "fuse_gates", "negative size of fused gates");
+
+    if (max_qubits == 0) {
+        return gates;
+    }
+
+    std::vector<qs::Gate> fused;
+    // blocks which can still grow, they act on disjoint qubits so their order does not matter
+    std::vector<Block> open;
+
+    for (qs::Gate &gate : gates) {
+        // gates which differ between shots end all blocks, so that the gates before them are applied once for all shots
+        if (gate.type == qs::GateType::BARRIER || gate.type == qs::GateType::CHANNEL || gate.is_dynamic()) {
+            for (Block &block : open) {
+                emit(block, fused);
+            }
+            open.clear();
+            fused.push_back(gate);
+            continue;
+        }
+
+        // parameterized gates are kept, since their matrix changes after the compilation
+        if (!gate.is_parametric() && gate.is_identity()) {
+            continue;
+        }
+
+        std::vector<int> qubits = gate.qubits();
+
+        // blocks which must be finished before the gate or merged with it
+        std::vector<Block> touched;
+        std::vector<Block> untouched;
+        std::vector<int> merged_qubits(qubits);
+        for (Block &block : open) {
+            if (overlaps(block.qubits, qubits)) {
+                add_qubits(merged_qubits, block.qubits);
+                touched.push_back(block);
+            } else {
+                untouched.push_back(block);
+            }
+        }
+        open = untouched;
+
+        // function gates have their own kernel and gates conditioned on classical bits are applied only in some shots
+        // parameterized gates stay separate, so that binding new values recomputes only their own matrix
+        bool mergeable = gate.type == qs::GateType::UNITARY && gate.condition_bits.empty() && !gate.is_parametric();
+
+        if (mergeable && merged_qubits.size() <= max_qubits) {
+            // the gate follows all gates of the touched blocks, which commute with each other
+            Block block;
+            block.qubits = merged_qubits;
+            for (Block &other : touched) {
+                block.gates.insert(block.gates.end(), other.gates.begin(), other.gates.end());
+            }
+            block.gates.push_back(gate);
+            open.push_back(block);
+            continue;
+        }
+
+        for (Block &block : touched) {
+            emit(block, fused);
+        }
+        if (mergeable && qubits.size() <= max_qubits) {
+            open.push_back(Block{qubits, std::vector<qs::Gate>{gate}});
+        } else {
+            fused.push_back(gate);
+        }
+    }
+
+    for (Block &block : open) {
+        emit(block, fused);
+    }
+
+    return fused;
+}
+
+qs::Gate qs::merge_gates(std::vector<qs::Gate> &gates, std::vector<int> &qubits) {
+    int k = qubits.size();
+    int dim = 1 << k;
+
+    // gates acting on qubits 0, ..., k - 1 of the block instead of the circuit
+    std::vector<qs::Gate> local;
+    std::string label;
+    for (qs::Gate &gate : gates) {
+        qs::check_err(gate.type != qs::GateType::UNITARY, "merge_gates", "only unitary gates can be merged");
+
+        std::vector<int> targets;
+        std::vector<int> controls;
+        for (int qubit : gate.targets) {
+            int index = std::find(qubits.begin(), qubits.end(), qubit) - qubits.begin();
+            qs::check_err(index == k, "merge_gates", "gate acts outside of the given qubits");
+            targets.push_back(index);
+        }
+        for (int qubit : gate.controls) {
+            int index = std::find(qubits.begin(), qubits.end(), qubit) - qubits.begin();
+            qs::check_err(index == k, "merge_gates", "gate acts outside of the given qubits");
+            controls.push_back(index);
+        }
+        local.push_back(qs::Gate(gate.matrix, targets, controls));
+
+        label += (label.empty() ? "" : " ") + gate.label;
+    }
+
+    // every column of the merged matrix is the sequence of gates applied to a basis vector
+    qs::c_mat items(dim);
+    qs::c_vec column(dim);
+    for (int c = 0; c < dim; ++c) {
+        std::fill(column.begin(), column.end(), qs::Complex());
+        column[c] = qs::Complex(1);
+        for (qs::Gate &gate : local) {
+            gate.apply(column, k);
+        }
+        for (int r = 0; r < dim; ++r) {
+            items[r][c] = column[r];
+        }
+    }
+
+    qs::Gate merged(qs::Unitary(dim, items, "F"), qubits);
+    // list the merged gates, i.e. {H[0] CX[0,1]}
+    merged.label = "{" + label + "}";
+    return merged;
+}
@@ -0,0 +1,26 @@
+#ifndef __FUSION_HPP__
+#define __FUSION_HPP__
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../utils/err.hpp"
+#include "./gate.hpp"
+#include "./unitary.hpp"
+
+namespace qs {
+
+    // default maximal number of qubits of a fused gate
+    constexpr int default_fusion_size = 4;
+
+    // optimize list of gates of a circuit so that the state vector is visited fewer times
+    // identity gates are dropped and gates are merged into blocks acting on at most max_qubits qubits
+    // gates are never moved across barriers, max_qubits 0 returns the gates unchanged
+    std::vector<Gate> fuse_gates(std::vector<Gate> &gates, int max_qubits);
+
+    // multiply gates into a single gate acting on the union of their qubits in the given order
+    Gate merge_gates(std::vector<Gate> &gates, std::vector<int> &qubits);
+};
+
+#endif
@@ -0,0 +1,321 @@
+#include "./gate.hpp"
+
+qs::Gate::Gate() {
+    qs::Barrier barrier;
+    this->type = qs::GateType::BARRIER;
+    this->label = barrier.label;
+    this->kind = qs::GateKind::GENERAL;
+    this->bit = -1;
+    this->condition_value = 0;
+    this->position = 0;
+}
+
+// check that no qubit is used twice
+static void check_unique(std::vector<int> &qubits) {
+    for (int i = 0; i < qubits.size(); ++i) {
+        for (int j = i + 1; j < qubits.size(); ++j) {
+            qs::check_err(qubits[i] == qubits[j], "Gate", "control and target qubits are not unique");
+        }
+    }
+}
+
+// label the gate with the qubits it acts on, i.e. H[0], CX[0,1] or Uf[0,1,2]
+static std::string qubit_label(std::string name, std::vector<int> &qubits) {
+    std::string label = name + "[";
+    for (int i = 0; i < qubits.size(); ++i) {
+        if (i != 0) {
+            label += ",";
+        }
+        label += std::to_string(qubits[i]);
+    }
+    return label + "]";
+}
+
+qs::Gate::Gate(qs::Unitary matrix, std::vector<int> targets, std::vector<int> controls) {
+    qs::check_err(targets.empty(), "Gate", "no target qubits");
+    qs::check_dims("Gate", matrix.dim, 1 << targets.size());
+
+    this->type = qs::GateType::UNITARY;
+    this->matrix = matrix;
+    // kernels read the small matrix of the gate directly
+    this->matrix.to_dense();
+    this->targets = targets;
+    this->controls = controls;
+    this->kind = qs::GateKind::GENERAL;
+    this->bit = -1;
+    this->condition_value = 0;
+    this->position = 0;
+
+    // controls go first in the label
+    std::vector<int> qubits = this->qubits();
+    check_unique(qubits);
+    this->label = qubit_label(std::string(controls.size(), 'C') + matrix.label, qubits);
+}
+
+qs::Gate::Gate(std::vector<std::size_t> table, std::vector<int> inputs, std::vector<int> outputs, std::string name) {
+    qs::check_err(inputs.empty() || outputs.empty(), "Gate", "function needs input and output qubits");
+    qs::check_dims("Gate", table.size(), 1 << inputs.size());
+    for (std::size_t value : table) {
+        qs::check_err(value >= ((std::size_t)1 << outputs.size()), "Gate", "function value does not fit into output qubits");
+    }
+
+    this->type = qs::GateType::FUNCTION;
+    this->targets = outputs;
+    this->controls = inputs;
+    this->table = std::make_shared<std::vector<std::size_t>>(table);
+    this->kind = qs::GateKind::GENERAL;
+    this->bit = -1;
+    this->condition_value = 0;
+    this->position = 0;
+
+    std::vector<int> qubits = this->qubits();
+    check_unique(qubits);
+    this->label = qubit_label(name, qubits);
+}
+
+qs::Gate::Gate(qs::Channel channel, std::vector<int> qubits) {
+    qs::check_err(qubits.empty(), "Gate", "no target qubits");
+    qs::check_dims("Gate", channel.dim, 1 << qubits.size());
+
+    this->type = qs::GateType::CHANNEL;
+    this->targets = qubits;
+    this->channel = std::make_shared<qs::Channel>(channel);
+    this->kind = qs::GateKind::GENERAL;
+    this->bit = -1;
+    this->condition_value = 0;
+    this->position = 0;
+
+    check_unique(qubits);
+    this->label = qubit_label(channel.label, qubits);
+}
+
+qs::Gate::Gate(qs::GateType type, int qubit, int bit) {
+    qs::check_err(type != qs::GateType::MEASURE && type != qs::GateType::RESET, "Gate", "only measurement and reset are given by a qubit");
+    qs::check_err(type == qs::GateType::MEASURE && bit < 0, "Gate", "measurement needs a classical bit");
+
+    this->type = type;
+    this->targets = {qubit};
+    this->kind = qs::GateKind::GENERAL;
+    this->bit = type == qs::GateType::MEASURE ? bit : -1;
+    this->condition_value = 0;
+    this->position = 0;
+
+    // i.e. M[0]->1 for measurement into classical bit 1 and R[0] for reset
+    this->label = qubit_label(type == qs::GateType::MEASURE ? "M" : "R", this->targets);
+    if (type == qs::GateType::MEASURE) {
+        this->label += "->" + std::to_string(bit);
+    }
+}
+
+std::vector<int> qs::Gate::bits(std::vector<int> &qubits, int n_qubits) {
+    std::vector<int> bits;
+    bits.reserve(qubits.size());
+    for (int qubit : qubits) {
+        bits.push_back(qs::_qubit_bit(qubit, n_qubits));
+    }
+    return bits;
+}
+
+std::vector<int> qs::Gate::qubits() {
+    std::vector<int> qubits(this->controls);
+    qubits.insert(qubits.end(), this->targets.begin(), this->targets.end());
+    return qubits;
+}
+
+void qs::Gate::condition(std::vector<int> bits, std::uint64_t value) {
+    qs::check_err(bits.empty() || bits.size() > 64, "Gate::condition", "condition needs 1 to 64 classical bits");
+    qs::check_err(bits.size() < 64 && value >> bits.size() != 0, "Gate::condition", "value does not fit into the classical bits");
+
+    this->condition_bits = bits;
+    this->condition_value = value;
+
+    // i.e. X[1]?1=1 for a gate applied if classical bit 1 holds 1
+    std::string digits;
+    for (int i = bits.size() - 1; i >= 0; --i) {
+        digits += (value >> i) & 1 ? '1' : '0';
+    }
+    std::string label = qubit_label("", bits);
+    this->label += "?" + label.substr(1, label.size() - 2) + "=" + digits;
+}
+
+bool qs::Gate::is_dynamic() {
+    return this->type == qs::GateType::MEASURE || this->type == qs::GateType::RESET || !this->condition_bits.empty();
+}
+
+bool qs::Gate::condition_holds(std::uint64_t reg, int n_bits) {
+    std::uint64_t value = 0;
+    for (int bit : this->condition_bits) {
+        value = (value << 1) | ((reg >> (n_bits - 1 - bit)) & 1);
+    }
+    return value == this->condition_value;
+}
+
+bool qs::Gate::is_parametric() {
+    return this->type == qs::GateType::UNITARY && this->matrix.is_parametric();
+}
+
+void qs::Gate::bind(std::map<std::string, double> &values) {
+    this->matrix.bind(values);
+    this->classify();
+}
+
+bool qs::Gate::is_identity(double tolerance) {
+    if (this->type == qs::GateType::BARRIER || this->type == qs::GateType::CHANNEL || this->type == qs::GateType::MEASURE || this->type == qs::GateType::RESET) {
+        return false;
+    }
+
+    // function which is zero everywhere flips no output qubit
+    if (this->type == qs::GateType::FUNCTION) {
+        return std::all_of(this->table->begin(), this->table->end(), [](std::size_t value) { return value == 0; });
+    }
+
+    // controls do not matter, the identity is applied either way
+    for (int r = 0; r < this->matrix.dim; ++r) {
+        for (int c = 0; c < this->matrix.dim; ++c) {
+            qs::Complex expected = qs::Complex(r == c ? 1 : 0);
+            qs::Complex diff = this->matrix.items[r][c] - expected;
+            if (diff.Re * diff.Re + diff.Im * diff.Im > tolerance * tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void qs::Gate::classify(double tolerance) {
+    // functions have their own kernel
+    if (this->type != qs::GateType::UNITARY) {
+        return;
+    }
+
+    if (this->is_identity(tolerance)) {
+        this->kind = qs::GateKind::IDENTITY;
+        return;
+    }
+
+    int dim = this->matrix.dim;
+    std::vector<std::size_t> permutation(dim);
+    qs::c_vec phases(dim);
+    std::vector<bool> used(dim, false);
+    bool diagonal = true;
+
+    for (int c = 0; c < dim; ++c) {
+        int row = -1;
+        for (int r = 0; r < dim; ++r) {
+            qs::Complex x = this->matrix.items[r][c];
+            if (x.Re * x.Re + x.Im * x.Im <= tolerance * tolerance) {
+                continue;
+            }
+            // more than one nonzero entry in a column or row means a general matrix
+            if (row != -1 || used[r]) {
+                this->kind = qs::GateKind::GENERAL;
+                return;
+            }
+            row = r;
+        }
+        if (row == -1) {
+            this->kind = qs::GateKind::GENERAL;
+            return;
+        }
+        used[row] = true;
+        permutation[c] = row;
+        phases[c] = this->matrix.items[row][c];
+        diagonal = diagonal && row == c;
+    }
+
+    this->kind = diagonal ? qs::GateKind::DIAGONAL : qs::GateKind::PERMUTATION;
+    this->permutation = permutation;
+    this->phases = phases;
+}
+
+void qs::Gate::apply(qs::c_vec &state, int n_qubits, int n_threads) {
+    if (this->type == qs::GateType::BARRIER || this->kind == qs::GateKind::IDENTITY) {
+        return;
+    }
+
+    qs::check_err(this->type == qs::GateType::CHANNEL, "Gate::apply", "noise channel cannot be applied to a pure state");
+    qs::check_err(this->type == qs::GateType::MEASURE || this->type == qs::GateType::RESET, "Gate::apply", "measurement outcome has to be sampled by the circuit");
+
+    std::vector<int> control_bits = qs::Gate::bits(this->controls, n_qubits);
+    std::vector<int> target_bits = qs::Gate::bits(this->targets, n_qubits);
+
+    if (this->type == qs::GateType::FUNCTION) {
+        qs::_apply_function(state, *this->table, control_bits, target_bits, n_threads);
+        return;
+    }
+
+    switch (this->kind) {
+        case qs::GateKind::DIAGONAL:
+            qs::_apply_diagonal(state, this->phases, target_bits, control_bits, n_threads);
+            return;
+        case qs::GateKind::PERMUTATION:
+            qs::_apply_permutation(state, this->permutation, this->phases, target_bits, control_bits, n_threads);
+            return;
+        default:
+            break;
+    }
+
+    if (this->targets.size() == 1) {
+        qs::_apply_c1q(state, this->matrix.items, target_bits[0], control_bits, n_threads);
+        return;
+    }
+
+    qs::_apply_kq(state, this->matrix.items, target_bits, control_bits, n_threads);
+}
+
+void qs::Gate::apply(qs::SparseVec &state, int n_qubits) {
+    if (this->type == qs::GateType::BARRIER || this->kind == qs::GateKind::IDENTITY) {
+        return;
+    }
+
+    qs::check_err(this->type == qs::GateType::CHANNEL, "Gate::apply", "noise channel cannot be applied to a pure state");
+    qs::check_err(this->type == qs::GateType::MEASURE || this->type == qs::GateType::RESET, "Gate::apply", "measurement outcome has to be sampled by the circuit");
+
+    std::vector<int> control_bits = qs::Gate::bits(this->controls, n_qubits);
+    std::vector<int> target_bits = qs::Gate::bits(this->targets, n_qubits);
+
+    if (this->type == qs::GateType::FUNCTION) {
+        qs::_sparse_apply_function(state, *this->table, control_bits, target_bits);
+        return;
+    }
+
+    switch (this->kind) {
+        case qs::GateKind::DIAGONAL:
+            qs::_sparse_apply_diagonal(state, this->phases, target_bits, control_bits);
+            return;
+        case qs::GateKind::PERMUTATION:
+            qs::_sparse_apply_permutation(state, this->permutation, this->phases, target_bits, control_bits);
+            return;
+        default:
+            qs::_sparse_apply_kq(state, this->matrix.items, target_bits, control_bits);
+    }
+}
+
+qs::Unitary qs::Gate::expand(int n_qubits) {
+    qs::check_err(this->type == qs::GateType::BARRIER, "expand", "barrier cannot be expanded");
+    qs::check_err(this->type == qs::GateType::CHANNEL, "expand", "noise channel cannot be expanded");
+    qs::check_err(this->is_dynamic(), "expand", "measurement, reset and conditioned gates cannot be expanded");
+
+    std::size_t dim = (std::size_t)1 << n_qubits;
+
+    // column c of the full operator is the gate applied to basis vector c, which populates at most 2^k entries
+    // the columns are collected as rows of the transposed operator
+    qs::c_csr columns(dim);
+    for (std::size_t c = 0; c < dim; ++c) {
+        qs::SparseVec column;
+        column.indices.push_back(c);
+        column.amplitudes.push_back(qs::Complex(1));
+        this->apply(column, n_qubits);
+        columns.cols.insert(columns.cols.end(), column.indices.begin(), column.indices.end());
+        columns.values.insert(columns.values.end(), column.amplitudes.begin(), column.amplitudes.end());
+        columns.row_ptr[c + 1] = columns.values.size();
+    }
+
+    qs::Unitary full(dim, qs::_transpose(columns), this->label);
+    full.compact();
+    return full;
+}
+
+void qs::Gate::symbol() {
+    std::cout << this->label;
+}
@@ -0,0 +1,126 @@
+#ifndef __GATE_HPP__
+#define __GATE_HPP__
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../lib/sparse_op.hpp"
+#include "../lib/sv_op.hpp"
+#include "../utils/err.hpp"
+#include "./noise.hpp"
+#include "./unitary.hpp"
+
+namespace qs {
+
+    // kind of a record in the list of gates of a circuit
+    enum GateType : char {
+        BARRIER = 'b',
+        UNITARY = 'u',
+        FUNCTION = 'f',
+        CHANNEL = 'n',
+        // mid-circuit measurement of the target qubit into a classical bit, the state collapses
+        MEASURE = 'm',
+        // measurement of the target qubit followed by flipping it to |0> if the outcome was 1
+        RESET = 'r',
+    };
+
+    // structure of the matrix of a gate which selects the kernel used to apply it
+    enum GateKind : char {
+        GENERAL = 'g',
+        IDENTITY = 'i',
+        DIAGONAL = 'd',
+        PERMUTATION = 'p',
+    };
+
+    // compact gate record that stores only the small matrix and the qubits it acts on
+    // the gate is applied in place to the state vector and is never expanded to 2^n x 2^n unless requested
+    class Gate {
+    public:
+        GateType type;
+        // matrix of dimension 2^k acting on k target qubits
+        Unitary matrix;
+        // target qubits, the first one corresponds to the most significant bit of the matrix index
+        std::vector<int> targets;
+        // control qubits, the matrix is applied only to amplitudes where all of them are |1>
+        // input qubits x of a function gate
+        std::vector<int> controls;
+        // values f(x) of a function gate |x>|y> -> |x>|y xor f(x)>, shared by copies of the gate
+        std::shared_ptr<std::vector<std::size_t>> table;
+        // noise channel acting on the target qubits, it can be applied only to a density matrix or sampled by a trajectory
+        std::shared_ptr<Channel> channel;
+        // classical bit written by a measurement
+        int bit;
+        // file to which a barrier writes the state vector and the number of gates of the circuit before the barrier
+        std::string snapshot;
+        std::size_t position;
+        // the gate is applied only if the classical bits hold the value, the first one is its most significant bit
+        std::vector<int> condition_bits;
+        std::uint64_t condition_value;
+        // symbol representation of the gate
+        std::string label;
+
+        // structure of the matrix, general until the gate is classified
+        GateKind kind;
+        // column c of a diagonal or permutation matrix has its only nonzero entry phases[c] in row permutation[c]
+        std::vector<std::size_t> permutation;
+        c_vec phases;
+
+        // construct a barrier
+        Gate();
+        // construct gate acting on the given target qubits if all control qubits are |1>
+        Gate(Unitary matrix, std::vector<int> targets, std::vector<int> controls);
+        // construct gate acting on the given target qubits
+        Gate(Unitary matrix, std::vector<int> targets) : Gate(matrix, targets, std::vector<int>{}){};
+        // construct gate acting on a single qubit
+        Gate(Unitary matrix, int target) : Gate(matrix, std::vector<int>{target}){};
+        // construct gate of a classical function f(x) = table[x] which maps |x>|y> to |x>|y xor f(x)>
+        // x is read from the input qubits and y from the output qubits, the first ones are the most significant
+        Gate(std::vector<std::size_t> table, std::vector<int> inputs, std::vector<int> outputs, std::string name = "Uf");
+        // construct noise channel acting on the given qubits
+        Gate(Channel channel, std::vector<int> qubits);
+        // construct measurement of the qubit into the classical bit or reset of the qubit
+        Gate(GateType type, int qubit, int bit = -1);
+
+        // convert qubit indices into bit positions in the state index
+        static std::vector<int> bits(std::vector<int> &qubits, int n_qubits);
+
+        // all qubits the gate acts on, controls first
+        std::vector<int> qubits();
+        // apply the gate only if the classical bits hold the value
+        void condition(std::vector<int> bits, std::uint64_t value);
+        // check if the gate is a measurement, reset or is conditioned on classical bits, so its effect differs between shots
+        bool is_dynamic();
+        // check if the condition holds for the classical register of n_bits bits, the first bit is the most significant
+        bool condition_holds(std::uint64_t reg, int n_bits);
+        // check if the matrix depends on symbols bound by the circuit
+        bool is_parametric();
+        // recompute the matrix from the bound values of its symbols and pick its kernel again
+        void bind(std::map<std::string, double> &values);
+        // check if the gate leaves every state unchanged up to the tolerance
+        bool is_identity(double tolerance = 1e-12);
+        // detect identity, diagonal and permutation matrices so that they are applied without matrix products
+        // entries smaller than the tolerance are considered zero
+        void classify(double tolerance = 1e-12);
+
+        // apply the gate in place to a state vector of n_qubits qubits using n_threads threads
+        void apply(c_vec &state, int n_qubits, int n_threads = 1);
+        // apply the gate in place to a sparse state vector of n_qubits qubits
+        void apply(SparseVec &state, int n_qubits);
+
+        // expand the gate into a full unitary operator on n_qubits qubits, built column by column in sparse storage
+        Unitary expand(int n_qubits);
+
+        void symbol();
+    };
+
+    // convert qubit index (qubit 0 is the leftmost in tensor product) to bit position in the state index
+    inline int _qubit_bit(int qubit, int n_qubits) {
+        return n_qubits - 1 - qubit;
+    }
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "./noise.hpp"
+
+// label the channel with its parameter, i.e. DEP(0.01)
+static std::string channel_label(std::string name, double p) {
+    std::string value = std::to_string(p);
+    value.erase(value.find_last_not_of('0') + 1);
+    if (value.back() == '.') {
+        value.pop_back();
+    }
+    return name + "(" + value + ")";
+}
+
+static void check_probability(std::string name, double p) {
+    qs::check_err(p < 0 || p > 1, name, "probability must be in [0, 1]");
+}
+
+qs::Channel::Channel(int dim, std::vector<qs::c_mat> kraus, std::string label, double tolerance) {
+    qs::check_err(kraus.empty(), "Channel", "no Kraus operators");
+    qs::check_err(dim < 2 || (dim & (dim - 1)) != 0, "Channel", "dimension must be a power of two");
+
+    // completeness relation sum_i K_i^+ K_i = I, i.e. the channel preserves the trace
+    for (qs::c_mat &k : kraus) {
+        qs::check_dims("Channel", k.size(), dim);
+    }
+    for (int r = 0; r < dim; ++r) {
+        for (int c = 0; c < dim; ++c) {
+            qs::Complex sum;
+            for (qs::c_mat &k : kraus) {
+                for (int i = 0; i < dim; ++i) {
+                    sum += k[i][r].conjugate() * k[i][c];
+                }
+            }
+            sum -= qs::Complex(r == c ? 1 : 0);
+            qs::check_err(sum.Re * sum.Re + sum.Im * sum.Im > tolerance * tolerance, "Channel", "Kraus operators do not preserve the trace");
+        }
+    }
+
+    this->dim = dim;
+    this->kraus = kraus;
+    this->label = label;
+}
+
+int qs::Channel::n_qubits() {
+    int k = 0;
+    while ((1 << k) < this->dim) {
+        ++k;
+    }
+    return k;
+}
+
+qs::c_mat qs::Channel::superoperator() {
+    int dim = this->dim;
+    qs::c_mat s(dim * dim);
+    for (qs::c_mat &k : this->kraus) {
+        for (int a = 0; a < dim; ++a) {
+            for (int b = 0; b < dim; ++b) {
+                for (int c = 0; c < dim; ++c) {
+                    for (int d = 0; d < dim; ++d) {
+                        s[a * dim + b][c * dim + d] += k[a][c] * k[b][d].conjugate();
+                    }
+                }
+            }
+        }
+    }
+    return s;
+}
+
+static std::vector<qs::c_mat> depolarizing(double p) {
+    check_probability("Depolarizing", p);
+    double a = sqrt(1 - p);
+    double b = sqrt(p / 3);
+    return {
+        qs::c_mat({{qs::Complex(a), qs::Complex(0)}, {qs::Complex(0), qs::Complex(a)}}),
+        qs::c_mat({{qs::Complex(0), qs::Complex(b)}, {qs::Complex(b), qs::Complex(0)}}),
+        qs::c_mat({{qs::Complex(0), qs::Complex(0, -b)}, {qs::Complex(0, b), qs::Complex(0)}}),
+        qs::c_mat({{qs::Complex(b), qs::Complex(0)}, {qs::Complex(0), qs::Complex(-b)}}),
+    };
+}
+
+static std::vector<qs::c_mat> amplitude_damping(double gamma) {
+    check_probability("AmplitudeDamping", gamma);
+    return {
+        qs::c_mat({{qs::Complex(1), qs::Complex(0)}, {qs::Complex(0), qs::Complex(sqrt(1 - gamma))}}),
+        qs::c_mat({{qs::Complex(0), qs::Complex(sqrt(gamma))}, {qs::Complex(0), qs::Complex(0)}}),
+    };
+}
+
+static std::vector<qs::c_mat> dephasing(double p) {
+    check_probability("Dephasing", p);
+    double a = sqrt(1 - p);
+    double b = sqrt(p);
+    return {
+        qs::c_mat({{qs::Complex(a), qs::Complex(0)}, {qs::Complex(0), qs::Complex(a)}}),
+        qs::c_mat({{qs::Complex(b), qs::Complex(0)}, {qs::Complex(0), qs::Complex(-b)}}),
+    };
+}
+
+std::vector<double> qs::Channel::kraus_weights(double tolerance) {
+    std::vector<double> weights;
+    for (qs::c_mat &k : this->kraus) {
+        // K^+ K has to be a multiple of identity
+        double weight = 0;
+        for (int i = 0; i < this->dim; ++i) {
+            weight += k[i][0].Re * k[i][0].Re + k[i][0].Im * k[i][0].Im;
+        }
+        for (int r = 0; r < this->dim; ++r) {
+            for (int c = 0; c < this->dim; ++c) {
+                qs::Complex sum;
+                for (int i = 0; i < this->dim; ++i) {
+                    sum += k[i][r].conjugate() * k[i][c];
+                }
+                sum -= qs::Complex(r == c ? weight : 0);
+                if (sum.Re * sum.Re + sum.Im * sum.Im > tolerance * tolerance) {
+                    return {};
+                }
+            }
+        }
+        weights.push_back(weight);
+    }
+    return weights;
+}
+
+qs::Depolarizing::Depolarizing(double p) : qs::Channel(2, depolarizing(p), channel_label("DEP", p)) {}
+
+qs::AmplitudeDamping::AmplitudeDamping(double gamma) : qs::Channel(2, amplitude_damping(gamma), channel_label("AD", gamma)) {}
+
+qs::Dephasing::Dephasing(double p) : qs::Channel(2, dephasing(p), channel_label("DPH", p)) {}
@@ -0,0 +1,53 @@
+#ifndef __NOISE_HPP__
+#define __NOISE_HPP__
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../lib/complex.hpp"
+#include "../lib/vec_op.hpp"
+#include "../utils/err.hpp"
+
+namespace qs {
+
+    // quantum channel rho -> sum_i K_i rho K_i^+ given by Kraus operators of dimension 2^k acting on k qubits
+    class Channel {
+    public:
+        int dim;
+        std::vector<c_mat> kraus;
+        std::string label;
+
+        // the Kraus operators have to satisfy sum_i K_i^+ K_i = I up to the tolerance
+        Channel(int dim, std::vector<c_mat> kraus, std::string label, double tolerance = 1e-9);
+
+        // number of qubits the channel acts on
+        int n_qubits();
+        // superoperator sum_i K_i ⊗ conj(K_i) acting on the vectorized density matrix
+        // the row index of rho is the most significant part of the index of the superoperator
+        c_mat superoperator();
+        // weights w_i of operators with K_i^+ K_i = w_i I, which are chosen with probability w_i independently of the state
+        // empty if some operator is not a scaled unitary and its probability has to be computed from the state
+        std::vector<double> kraus_weights(double tolerance = 1e-9);
+    };
+
+    // rho -> (1 - p) rho + p / 3 (X rho X + Y rho Y + Z rho Z)
+    class Depolarizing : public Channel {
+    public:
+        Depolarizing(double p);
+    };
+
+    // decay |1> -> |0> with probability gamma
+    class AmplitudeDamping : public Channel {
+    public:
+        AmplitudeDamping(double gamma);
+    };
+
+    // rho -> (1 - p) rho + p Z rho Z
+    class Dephasing : public Channel {
+    public:
+        Dephasing(double p);
+    };
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "./pauli.hpp"
+
+std::size_t qs::PauliTerm::x_mask() {
+    int n = this->paulis.size();
+    std::size_t mask = 0;
+    for (int q = 0; q < n; ++q) {
+        if (this->paulis[q] == 'X' || this->paulis[q] == 'Y') {
+            mask |= (std::size_t)1 << (n - 1 - q);
+        }
+    }
+    return mask;
+}
+
+std::size_t qs::PauliTerm::z_mask() {
+    int n = this->paulis.size();
+    std::size_t mask = 0;
+    for (int q = 0; q < n; ++q) {
+        if (this->paulis[q] == 'Z' || this->paulis[q] == 'Y') {
+            mask |= (std::size_t)1 << (n - 1 - q);
+        }
+    }
+    return mask;
+}
+
+int qs::PauliTerm::n_y() {
+    return std::count(this->paulis.begin(), this->paulis.end(), 'Y');
+}
+
+qs::PauliSum::PauliSum(int n_qubits) {
+    // the masks of the state vector kernels hold at most 63 qubits, wider observables are evaluated only on the tableau
+    qs::check_err(n_qubits < 1, "PauliSum", "at least one qubit is required");
+    this->n_qubits = n_qubits;
+}
+
+void qs::PauliSum::add(double coefficient, std::string paulis) {
+    qs::check_dims("PauliSum::add", paulis.size(), this->n_qubits);
+    for (char &p : paulis) {
+        p = toupper(p);
+        qs::check_err(p != 'I' && p != 'X' && p != 'Y' && p != 'Z', "PauliSum::add", "unknown Pauli operator, use I, X, Y or Z");
+    }
+    this->terms.push_back(qs::PauliTerm(coefficient, paulis));
+}
+
+void qs::PauliSum::add(double coefficient, std::string paulis, std::vector<int> qubits) {
+    qs::check_dims("PauliSum::add", paulis.size(), qubits.size());
+    std::string full(this->n_qubits, 'I');
+    for (std::size_t i = 0; i < qubits.size(); ++i) {
+        qs::check_err(qubits[i] < 0 || qubits[i] >= this->n_qubits, "PauliSum::add", "qubit out of range");
+        qs::check_err(full[qubits[i]] != 'I', "PauliSum::add", "qubit is used twice");
+        full[qubits[i]] = paulis[i];
+    }
+    this->add(coefficient, full);
+}
+
+// terms with the same flipped bits, which share the products of amplitudes
+static std::map<std::size_t, std::vector<qs::PauliTerm>> group_terms(std::vector<qs::PauliTerm> &terms) {
+    std::map<std::size_t, std::vector<qs::PauliTerm>> groups;
+    for (qs::PauliTerm &term : terms) {
+        groups[term.x_mask()].push_back(term);
+    }
+    return groups;
+}
+
+// real part of coefficient * i^n_y * value summed over the terms of a group
+static double combine(std::vector<qs::PauliTerm> &group, qs::c_vec &values) {
+    double sum = 0;
+    for (std::size_t t = 0; t < group.size(); ++t) {
+        qs::Complex value = values[t];
+        // multiply by i^n_y
+        for (int k = 0; k < group[t].n_y() % 4; ++k) {
+            value = qs::Complex(-value.Im, value.Re);
+        }
+        sum += group[t].coefficient * value.Re;
+    }
+    return sum;
+}
+
+double qs::PauliSum::expectation(qs::c_vec &state, int n_threads) {
+    qs::check_dims("PauliSum::expectation", state.size(), (std::size_t)1 << this->n_qubits);
+
+    double sum = 0;
+    for (auto &group : group_terms(this->terms)) {
+        std::vector<std::size_t> z_masks;
+        for (qs::PauliTerm &term : group.second) {
+            z_masks.push_back(term.z_mask());
+        }
+        qs::c_vec values = qs::_pauli_expectations(state, group.first, z_masks, n_threads);
+        sum += combine(group.second, values);
+    }
+    return sum;
+}
+
+double qs::PauliSum::density_expectation(qs::c_vec &rho) {
+    std::size_t dim = (std::size_t)1 << this->n_qubits;
+    qs::check_dims("PauliSum::density_expectation", rho.size(), dim * dim);
+
+    double sum = 0;
+    for (auto &group : group_terms(this->terms)) {
+        std::vector<std::size_t> z_masks;
+        for (qs::PauliTerm &term : group.second) {
+            z_masks.push_back(term.z_mask());
+        }
+        qs::c_vec values = qs::_dm_pauli_traces(rho, this->n_qubits, group.first, z_masks);
+        sum += combine(group.second, values);
+    }
+    return sum;
+}
+
+qs::c_vec qs::PauliSum::apply(qs::c_vec &state, int n_threads) {
+    qs::check_dims("PauliSum::apply", state.size(), (std::size_t)1 << this->n_qubits);
+
+    qs::c_vec res(state.size());
+    for (qs::PauliTerm &term : this->terms) {
+        // coefficient * i^n_y
+        qs::Complex coefficient(term.coefficient);
+        for (int k = 0; k < term.n_y() % 4; ++k) {
+            coefficient = qs::Complex(-coefficient.Im, coefficient.Re);
+        }
+        qs::_add_pauli(state, res, term.x_mask(), term.z_mask(), coefficient, n_threads);
+    }
+    return res;
+}
+
+void qs::PauliSum::show() {
+    for (std::size_t t = 0; t < this->terms.size(); ++t) {
+        std::cout << (t == 0 ? "" : " + ") << this->terms[t].coefficient << " * " << this->terms[t].paulis;
+    }
+    std::cout << std::endl;
+}
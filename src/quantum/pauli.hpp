@@ -0,0 +1,61 @@
+#ifndef __PAULI_HPP__
+#define __PAULI_HPP__
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../lib/complex.hpp"
+#include "../lib/dm_op.hpp"
+#include "../lib/sv_op.hpp"
+#include "../lib/vec_op.hpp"
+#include "../utils/err.hpp"
+
+namespace qs {
+
+    // real multiple of a tensor product of Pauli operators, i.e. 0.5 * ZZI
+    class PauliTerm {
+    public:
+        double coefficient;
+        // one of I, X, Y, Z for every qubit, the first one acts on qubit 0
+        std::string paulis;
+
+        PauliTerm(double coefficient, std::string paulis) : coefficient(coefficient), paulis(paulis){};
+
+        // bits flipped by X and Y and bits whose phase is negated by Y and Z in the state index of n qubits
+        // the term is i^(number of Y) X^x Z^z
+        std::size_t x_mask();
+        std::size_t z_mask();
+        int n_y();
+    };
+
+    // hermitian observable given by a weighted sum of Pauli strings on n qubits
+    class PauliSum {
+    public:
+        int n_qubits;
+        std::vector<PauliTerm> terms;
+
+        PauliSum(int n_qubits);
+
+        // add term given by a Pauli letter for every qubit, i.e. add(0.5, "ZZI")
+        void add(double coefficient, std::string paulis);
+        // add term acting on the given qubits and as identity on the others, i.e. add(0.5, "ZZ", {0, 1})
+        void add(double coefficient, std::string paulis, std::vector<int> qubits);
+
+        // <psi|O|psi> of a normalized state vector
+        // terms flipping the same qubits are evaluated together in one pass over the amplitudes
+        double expectation(c_vec& state, int n_threads = 1);
+        // Tr(O rho) of a vectorized density matrix
+        double density_expectation(c_vec& rho);
+        // state O |psi>, which is not normalized
+        c_vec apply(c_vec& state, int n_threads = 1);
+
+        void show();
+    };
+};
+
+#endif
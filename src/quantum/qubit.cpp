@@ -1,6 +1,6 @@
 #include "./qubit.hpp"
 
-qs::Qubit::Qubit(int dim, qs::Complex coefficient, std::vector<qs::Complex> items, std::string label) {
+qs::Qubit::Qubit(int dim, qs::Complex coefficient, qs::c_vec items, std::string label) {
     this->dim = dim;
     this->label = label;
     this->items = items;
@@ -11,7 +11,7 @@ qs::Qubit::Qubit(int dim, qs::Complex coefficient, std::vector<qs::Complex> item
 
 qs::Qubit::Qubit(qs::BasicQubits basis, bool ket) {
     dim = 2;
-    this->items = std::vector<qs::Complex>(2);
+    this->items = qs::c_vec(2);
     std::string symbol(1, static_cast<char>(basis));
     this->label = this->add_brackets(symbol);
     if (ket) {
@@ -98,7 +98,7 @@ void qs::Bra::vector() {
 }
 
 qs::Bra qs::Bra::operator*(qs::Unitary &other) {
-    qs::c_vec new_items = qs::_vecmatmul(this->items, other.items);
+    qs::c_vec new_items = other.sparse ? qs::_vecmatmul(this->items, other.csr) : qs::_vecmatmul(this->items, other.items);
     std::string new_label = this->label + other.label;
     return qs::Bra(this->dim, new_items, new_label);
 }
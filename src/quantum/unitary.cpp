@@ -3,56 +3,194 @@
 qs::Unitary::Unitary(int dim, qs::Complex coefficient, qs::c_mat items, std::string label) {
     this->dim = dim;
     this->items = items;
+    this->sparse = false;
     this->label = label;
+    this->generator = nullptr;
+    this->conjugated = false;
     // multiply only if the coefficient is not 1
     if (coefficient.Re != 1 || coefficient.Im != 0) {
-        for (qs::c_vec &row : this->items) {
-            for (qs::Complex &item : row) {
-                item *= coefficient;
-            }
+        for (qs::Complex &item : this->items.flat()) {
+            item *= coefficient;
         }
     }
 }
 
+qs::Unitary::Unitary(int dim, qs::c_csr csr, std::string label) {
+    qs::check_dims("Unitary", csr.size(), dim);
+    this->dim = dim;
+    this->sparse = true;
+    this->csr = csr;
+    this->label = label;
+    this->generator = nullptr;
+    this->conjugated = false;
+}
+
+std::size_t qs::Unitary::nnz() {
+    return this->sparse ? this->csr.nnz() : qs::_nnz(this->items);
+}
+
+double qs::Unitary::fill() {
+    return this->dim == 0 ? 0 : (double)this->nnz() / ((double)this->dim * this->dim);
+}
+
+void qs::Unitary::to_dense() {
+    if (this->sparse) {
+        this->items = qs::_to_dense(this->csr);
+        this->csr = qs::c_csr();
+        this->sparse = false;
+    }
+}
+
+void qs::Unitary::to_sparse() {
+    if (!this->sparse) {
+        this->csr = qs::_to_csr(this->items);
+        this->items = qs::c_mat();
+        this->sparse = true;
+    }
+}
+
+void qs::Unitary::compact() {
+    if (this->dim >= qs::min_sparse_dim && this->fill() <= qs::max_sparse_fill) {
+        this->to_sparse();
+    } else {
+        this->to_dense();
+    }
+}
+
+bool qs::Unitary::is_parametric() {
+    for (qs::Parameter &parameter : this->parameters) {
+        if (parameter.is_symbol()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// angles of the matrix at the bound values
+static std::vector<double> angles(std::vector<qs::Parameter> &parameters, std::map<std::string, double> &values) {
+    std::vector<double> angles;
+    for (qs::Parameter &parameter : parameters) {
+        angles.push_back(parameter.evaluate(values));
+    }
+    return angles;
+}
+
+static void conjugate(qs::c_mat &m) {
+    for (qs::Complex &item : m.flat()) {
+        item = item.conjugate();
+    }
+}
+
+void qs::Unitary::bind(std::map<std::string, double> &values) {
+    qs::check_err(this->generator == nullptr, "bind", "matrix is not parameterized");
+
+    std::vector<double> bound = angles(this->parameters, values);
+    this->items = this->generator(bound, -1);
+    if (this->conjugated) {
+        conjugate(this->items);
+    }
+}
+
+qs::c_mat qs::Unitary::derivative(std::map<std::string, double> &values, std::string name) {
+    qs::check_err(this->generator == nullptr, "derivative", "matrix is not parameterized");
+
+    std::vector<double> bound = angles(this->parameters, values);
+    qs::c_mat sum(this->dim);
+    for (std::size_t i = 0; i < this->parameters.size(); ++i) {
+        if (!this->parameters[i].is_symbol() || this->parameters[i].name != name) {
+            continue;
+        }
+        qs::c_mat d = this->generator(bound, i);
+        for (std::size_t j = 0; j < d.flat().size(); ++j) {
+            sum.flat()[j] += d.flat()[j];
+        }
+    }
+    if (this->conjugated) {
+        conjugate(sum);
+    }
+    return sum;
+}
+
+// sparse copy of the matrix, used when the other operand is sparse
+static qs::c_csr as_csr(qs::Unitary &u) {
+    return u.sparse ? u.csr : qs::_to_csr(u.items);
+}
+
 qs::Unitary qs::Unitary::operator~() {
-    qs::c_mat new_items = qs::_dagger(this->items);
     std::string new_label = "(" + label + ")^+";
+    if (this->sparse) {
+        return qs::Unitary(this->dim, qs::_dagger(this->csr), new_label);
+    }
+    qs::c_mat new_items = qs::_dagger(this->items);
     return qs::Unitary(this->dim, new_items, new_label);
 }
 
 qs::Unitary qs::Unitary::operator*(qs::Unitary &other) {
     int new_dim = this->dim * other.dim;
-    qs::c_mat new_items = qs::_tensor(this->items, other.items);
     std::string new_label = this->label + " ⊗ " + other.label;
+
+    // fill of the tensor product is the product of fills, so products with identities or projectors are built sparse
+    if (this->sparse || other.sparse || (new_dim >= qs::min_sparse_dim && this->fill() * other.fill() <= qs::max_sparse_fill)) {
+        qs::c_csr a = as_csr(*this);
+        qs::c_csr b = as_csr(other);
+        qs::Unitary res(new_dim, qs::_tensor(a, b), new_label);
+        res.compact();
+        return res;
+    }
+    qs::c_mat new_items = qs::_tensor(this->items, other.items);
     return qs::Unitary(new_dim, new_items, new_label);
 }
 
 qs::Unitary qs::Unitary::operator%(qs::Unitary &other) {
-    qs::c_mat new_items = qs::_matmul(this->items, other.items);
     std::string new_label = "(" + this->label + ")(" + other.label + ")";
+    if (this->sparse || other.sparse) {
+        qs::c_csr a = as_csr(*this);
+        qs::c_csr b = as_csr(other);
+        qs::Unitary res(this->dim, qs::_matmul(a, b), new_label);
+        res.compact();
+        return res;
+    }
+    qs::c_mat new_items = qs::_matmul(this->items, other.items);
     return qs::Unitary(this->dim, new_items, new_label);
 }
 
 qs::Unitary qs::Unitary::operator+(qs::Unitary &other) {
-    qs::c_mat new_items = qs::_add(this->items, other.items);
     std::string new_label = "(" + this->label + " + " + other.label + ")";
+    if (this->sparse || other.sparse) {
+        qs::c_csr a = as_csr(*this);
+        qs::c_csr b = as_csr(other);
+        qs::Unitary res(this->dim, qs::_add(a, b), new_label);
+        res.compact();
+        return res;
+    }
+    qs::c_mat new_items = qs::_add(this->items, other.items);
     return qs::Unitary(this->dim, new_items, new_label);
 }
 
 qs::Unitary qs::Unitary::operator-(qs::Unitary &other) {
-    qs::c_mat new_items = qs::_sub(this->items, other.items);
     std::string new_label = "(" + this->label + " - " + other.label + ")";
+    if (this->sparse || other.sparse) {
+        qs::c_csr a = as_csr(*this);
+        qs::c_csr b = as_csr(other);
+        qs::Unitary res(this->dim, qs::_sub(a, b), new_label);
+        res.compact();
+        return res;
+    }
+    qs::c_mat new_items = qs::_sub(this->items, other.items);
     return qs::Unitary(this->dim, new_items, new_label);
 }
 
 qs::Unitary qs::Unitary::operator*(qs::Complex &c) {
-    qs::c_mat new_items = qs::_mul(c, this->items);
     std::string new_label = c.str() + "(" + this->label + ")";
+    if (this->sparse) {
+        return qs::Unitary(this->dim, qs::_mul(c, this->csr), new_label);
+    }
+    qs::c_mat new_items = qs::_mul(c, this->items);
     return qs::Unitary(this->dim, new_items, new_label);
 }
 
 qs::Ket qs::Unitary::operator*(qs::Ket &other) {
-    qs::c_vec new_items = qs::_matvecmul(this->items, other.items);
+    qs::c_vec new_items = this->sparse ? qs::_matvecmul(this->csr, other.items) : qs::_matvecmul(this->items, other.items);
     std::string new_label = this->label + other.label;
     return qs::Ket(this->dim, new_items, new_label);
 }
@@ -62,6 +200,11 @@ void qs::Unitary::symbol() {
 }
 
 void qs::Unitary::matrix() {
+    if (this->sparse) {
+        qs::c_mat dense = qs::_to_dense(this->csr);
+        qs::print_mat(dense);
+        return;
+    }
     qs::print_mat(this->items);
 }
 
@@ -83,10 +226,138 @@ qs::Proj::Proj(std::vector<qs::BasicQubits> bases) {
         kets.push_back(qs::Ket(basis));
         bras.push_back(qs::Bra(basis));
     }
+
+    // tensor product of single-qubit projectors, which is sparse for computational basis states
+    std::vector<qs::Unitary> projs;
+    projs.reserve(k);
+    for (int i = 0; i < k; ++i) {
+        projs.push_back(kets[i] * bras[i]);
+    }
+    qs::Unitary proj = qs::tensor_reduce(projs);
+
     qs::Ket ket = qs::tensor_reduce(kets);
     qs::Bra bra = qs::tensor_reduce(bras);
-    qs::Unitary proj = ket * bra;
     this->dim = proj.dim;
-    this->label = proj.label;
+    this->label = ket.label + bra.label;
     this->items = proj.items;
+    this->sparse = proj.sparse;
+    this->csr = proj.csr;
+}
+
+bool qs::Parameter::is_symbol() {
+    return !this->name.empty();
+}
+
+double qs::Parameter::evaluate(std::map<std::string, double> &values) {
+    if (!this->is_symbol()) {
+        return this->value;
+    }
+    auto it = values.find(this->name);
+    qs::check_err(it == values.end(), "bind", "parameter " + this->name + " is not bound");
+    return it->second;
+}
+
+std::string qs::Parameter::str() {
+    if (this->is_symbol()) {
+        return this->name;
+    }
+    std::ostringstream out;
+    out << this->value;
+    return out.str();
+}
+
+// e^(i phi)
+static qs::Complex phase(double phi) {
+    return qs::Complex(cos(phi), sin(phi));
+}
+
+// rotations exp(-i theta G / 2) with G^2 = I have derivative exp(-i (theta + pi) G / 2) / 2
+static double rotation_angle(std::vector<double> &angles, int derivative, double &scale) {
+    scale = derivative < 0 ? 1 : 0.5;
+    return derivative < 0 ? angles[0] : angles[0] + M_PI;
+}
+
+static qs::c_mat rx_matrix(std::vector<double> &angles, int derivative) {
+    double scale;
+    double theta = rotation_angle(angles, derivative, scale);
+    double c = scale * cos(theta / 2);
+    double s = scale * sin(theta / 2);
+    return qs::c_mat({{qs::Complex(c), qs::Complex(0, -s)}, {qs::Complex(0, -s), qs::Complex(c)}});
+}
+
+static qs::c_mat ry_matrix(std::vector<double> &angles, int derivative) {
+    double scale;
+    double theta = rotation_angle(angles, derivative, scale);
+    double c = scale * cos(theta / 2);
+    double s = scale * sin(theta / 2);
+    return qs::c_mat({{qs::Complex(c), qs::Complex(-s)}, {qs::Complex(s), qs::Complex(c)}});
+}
+
+static qs::c_mat rz_matrix(std::vector<double> &angles, int derivative) {
+    double scale;
+    double theta = rotation_angle(angles, derivative, scale);
+    qs::Complex s(scale);
+    return qs::c_mat({{s * phase(-theta / 2), qs::Complex(0)}, {qs::Complex(0), s * phase(theta / 2)}});
+}
+
+static qs::c_mat phase_matrix(std::vector<double> &angles, int derivative) {
+    if (derivative < 0) {
+        return qs::c_mat({{qs::Complex(1), qs::Complex(0)}, {qs::Complex(0), phase(angles[0])}});
+    }
+    return qs::c_mat({{qs::Complex(0), qs::Complex(0)}, {qs::Complex(0), qs::Complex(0, 1) * phase(angles[0])}});
+}
+
+static qs::c_mat u3_matrix(std::vector<double> &angles, int derivative) {
+    double c = cos(angles[0] / 2);
+    double s = sin(angles[0] / 2);
+    double phi = angles[1];
+    double lambda = angles[2];
+    qs::Complex i(0, 1);
+    switch (derivative) {
+        case 0:
+            return qs::c_mat({{qs::Complex(-s / 2), phase(lambda) * qs::Complex(-c / 2)}, {phase(phi) * qs::Complex(c / 2), phase(phi + lambda) * qs::Complex(-s / 2)}});
+        case 1:
+            return qs::c_mat({{qs::Complex(0), qs::Complex(0)}, {i * phase(phi) * qs::Complex(s), i * phase(phi + lambda) * qs::Complex(c)}});
+        case 2:
+            return qs::c_mat({{qs::Complex(0), i * phase(lambda) * qs::Complex(-s)}, {qs::Complex(0), i * phase(phi + lambda) * qs::Complex(c)}});
+        default:
+            return qs::c_mat({{qs::Complex(c), phase(lambda) * qs::Complex(-s)}, {phase(phi) * qs::Complex(s), phase(phi + lambda) * qs::Complex(c)}});
+    }
+}
+
+// set the angles of the gate and compute its matrix, symbols are zero until they are bound
+static void parameterize(qs::Unitary &gate, std::string name, std::vector<qs::Parameter> parameters, qs::Generator generator) {
+    std::map<std::string, double> zeros;
+    std::string label = name + "(";
+    for (std::size_t i = 0; i < parameters.size(); ++i) {
+        if (parameters[i].is_symbol()) {
+            zeros[parameters[i].name] = 0;
+        }
+        label += (i == 0 ? "" : ",") + parameters[i].str();
+    }
+
+    gate.label = label + ")";
+    gate.parameters = parameters;
+    gate.generator = generator;
+    gate.bind(zeros);
+}
+
+qs::RX::RX(qs::Parameter theta) {
+    parameterize(*this, "RX", {theta}, rx_matrix);
+}
+
+qs::RY::RY(qs::Parameter theta) {
+    parameterize(*this, "RY", {theta}, ry_matrix);
+}
+
+qs::RZ::RZ(qs::Parameter theta) {
+    parameterize(*this, "RZ", {theta}, rz_matrix);
+}
+
+qs::Phase::Phase(qs::Parameter lambda) {
+    parameterize(*this, "P", {lambda}, phase_matrix);
+}
+
+qs::U3::U3(qs::Parameter theta, qs::Parameter phi, qs::Parameter lambda) {
+    parameterize(*this, "U3", {theta, phi, lambda}, u3_matrix);
 }
@@ -4,10 +4,12 @@
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <string>
 #include <vector>
 
 #include "../lib/complex.hpp"
+#include "../lib/csr.hpp"
 #include "../lib/vec_op.hpp"
 #include "./basis.hpp"
 #include "./qubit.hpp"
@@ -17,16 +19,68 @@ namespace qs {
     class Bra;
     class Ket;
 
+    // matrices of at least this dimension with at most this fraction of nonzero entries are stored sparse
+    constexpr int min_sparse_dim = 64;
+    constexpr double max_sparse_fill = 0.25;
+
+    // angle of a parameterized gate, either a fixed value or a named symbol whose value is bound by the circuit
+    class Parameter {
+    public:
+        // name of the symbol, empty for a fixed value
+        std::string name;
+        double value;
+
+        Parameter(double value) : name(""), value(value){};
+        Parameter(std::string name) : name(name), value(0){};
+        Parameter(const char *name) : Parameter(std::string(name)){};
+
+        bool is_symbol();
+        // the fixed value or the bound value of the symbol
+        double evaluate(std::map<std::string, double> &values);
+        std::string str();
+    };
+
+    // matrix of a parameterized gate for the given angles, or its derivative by the angle with the given index if it is not negative
+    typedef c_mat (*Generator)(std::vector<double> &angles, int derivative);
+
     class Unitary {
     public:
         int dim;
+        // dense matrix, empty while the sparse storage is used
         c_mat items;
+        // sparse storage of large matrices with few nonzero entries, such as projectors, tensor products with identities or expanded gates
+        bool sparse;
+        c_csr csr;
         std::string label;
+        // angles of a parameterized gate and the function computing its matrix from them, the generator is null for other matrices
+        // results of operations on the matrix are not parameterized anymore
+        std::vector<Parameter> parameters;
+        Generator generator;
+        // the generated matrix is complex conjugated, used for the column half of density matrix gates
+        bool conjugated;
 
         Unitary(int dim, Complex coefficient, c_mat items, std::string label);
         Unitary(int dim, c_mat items, std::string label) : Unitary(dim, Complex(1), items, label){};
-        Unitary() : Unitary(2, c_mat(2, c_vec(2)), std::string("0")){};
-
+        Unitary(int dim, c_csr csr, std::string label);
+        Unitary() : Unitary(2, c_mat(2), std::string("0")){};
+
+        // number and fraction of nonzero entries
+        std::size_t nnz();
+        double fill();
+        // switch the storage, to_dense has to be called before accessing items of a sparse matrix
+        void to_dense();
+        void to_sparse();
+        // store the matrix sparse if it is large and has few nonzero entries, dense otherwise
+        void compact();
+
+        // check if some angle of the matrix is a symbol, so the matrix changes with the bound values
+        bool is_parametric();
+        // recompute the matrix from the bound values of its symbols
+        void bind(std::map<std::string, double> &values);
+        // derivative of the matrix by the symbol at the bound values, summed over all angles given by the symbol
+        c_mat derivative(std::map<std::string, double> &values, std::string name);
+
+        // operations keep the sparse storage if an operand is sparse and densify the result once it fills up
         // complex conjugate and transposition
         Unitary operator~();
         // perform tensor product for two unitary matrices
@@ -73,6 +127,36 @@ namespace qs {
         PauliZ() : Unitary(2, {{Complex(1), Complex(0)}, {Complex(0), Complex(-1)}}, std::string("Z")) {}
     };
 
+    // rotation exp(-i theta X / 2) around the x axis
+    class RX : public Unitary {
+    public:
+        RX(Parameter theta);
+    };
+
+    // rotation exp(-i theta Y / 2) around the y axis
+    class RY : public Unitary {
+    public:
+        RY(Parameter theta);
+    };
+
+    // rotation exp(-i theta Z / 2) around the z axis
+    class RZ : public Unitary {
+    public:
+        RZ(Parameter theta);
+    };
+
+    // phase shift diag(1, e^(i lambda))
+    class Phase : public Unitary {
+    public:
+        Phase(Parameter lambda);
+    };
+
+    // general single-qubit gate RZ(phi) RY(theta) RZ(lambda) up to the global phase, with U3(theta, 0, 0) = RY(theta)
+    class U3 : public Unitary {
+    public:
+        U3(Parameter theta, Parameter phi, Parameter lambda);
+    };
+
     class Proj : public Unitary {
     public:
         // creates a projection operator to a single qubit basis, i.e. |0><0| or |1><1|
@@ -83,7 +167,7 @@ namespace qs {
 
     class Barrier : public Unitary {
     public:
-        Barrier() : Unitary(0, {}, std::string("------")){};
+        Barrier() : Unitary(0, c_mat(), std::string("------")){};
     };
 
 };
@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <string>
 #include <vector>
 
 #include "./lib/gem.hpp"
+#include "./quantum/batch.hpp"
 #include "./quantum/circuit.hpp"
 #include "./quantum/unitary.hpp"
 #include "./utils/err.hpp"
@@ -32,6 +34,43 @@ std::vector<std::string> guess_secrets(qs::Results& results) {
     return secrets;
 }
 
+// run Simon's algorithm for all nonzero secrets of length n in one batch and report which of them were found
+void sweep(int n, int shots) {
+    // the template holds the Hadamard transform of the input, which is shared by all secrets
+    qs::QuantumCircuit circuit(2 * n, n, qs::BasicQubits::ZERO);
+    std::vector<int> first_n(n);
+    std::iota(first_n.begin(), first_n.end(), 0);
+    circuit.gate(qs::Hadamard(), first_n);
+
+    qs::Batch batch(circuit);
+    std::vector<std::string> secrets;
+    for (int value = 1; value < (1 << n); ++value) {
+        std::string s;
+        for (int i = n - 1; i >= 0; --i) {
+            s += std::to_string((value >> i) & 1);
+        }
+        secrets.push_back(s);
+        batch.add([s, first_n, n](qs::QuantumCircuit& variant) {
+            variant.oracle(qs::SimonOracle(s));
+            variant.gate(qs::Hadamard(), first_n);
+            for (int i = 0; i < n; ++i) {
+                variant.measure(i, i);
+            }
+        });
+    }
+
+    std::vector<qs::Results> results = batch.run(shots);
+
+    int found = 0;
+    for (int i = 0; i < secrets.size(); ++i) {
+        std::vector<std::string> guesses = guess_secrets(results[i]);
+        bool correct = std::find(guesses.begin(), guesses.end(), secrets[i]) != guesses.end();
+        found += correct;
+        std::cout << "secret: " << secrets[i] << (correct ? " (correct)" : " (not found)") << std::endl;
+    }
+    std::cout << "found " << found << " of " << secrets.size() << " secrets" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
     qs::check_err(argc % 2 == 0, "main", "Invalid number of arguments");
     qs::check_err(argc == 1, "main", "Invalid number of arguments");
@@ -39,6 +78,7 @@ int main(int argc, char* argv[]) {
     std::string s;
     int shots = 1024;
     bool verbose = false;
+    int sweep_n = 0;
 
     // parse command-line arguments
     for (int i = 1; i < argc; ++i) {
@@ -48,11 +88,18 @@ int main(int argc, char* argv[]) {
             verbose = std::stoi(argv[++i]);
         } else if (std::strcmp(argv[i], "--shots") == 0) {
             shots = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--sweep") == 0) {
+            sweep_n = std::stoi(argv[++i]);
         } else {
             qs::check_err(true, "main", std::string("Invalid argument: ") + std::string(argv[i]));
         }
     }
 
+    if (sweep_n > 0) {
+        sweep(sweep_n, shots);
+        return 0;
+    }
+
     // compute length of the string s
     int n = s.size();
 
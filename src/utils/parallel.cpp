@@ -0,0 +1,147 @@
+#include "./parallel.hpp"
+
+#include <algorithm>
+
+// set in threads which are executing tasks of the pool
+static thread_local bool in_task = false;
+
+qs::ThreadPool::ThreadPool() {
+    this->job = nullptr;
+    this->n_tasks = 0;
+    this->n_helpers = 0;
+    this->next_task = 0;
+    this->running = 0;
+    this->generation = 0;
+    this->stopping = false;
+}
+
+qs::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (std::thread& worker : this->workers) {
+        worker.join();
+    }
+}
+
+qs::ThreadPool& qs::ThreadPool::instance() {
+    static qs::ThreadPool pool;
+    return pool;
+}
+
+void qs::ThreadPool::take_tasks() {
+    bool was_in_task = in_task;
+    in_task = true;
+    int i;
+    while ((i = this->next_task.fetch_add(1)) < this->n_tasks) {
+        (*this->job)(i);
+    }
+    in_task = was_in_task;
+}
+
+void qs::ThreadPool::work(int index, long seen) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [&]() { return this->stopping || this->generation != seen; });
+            if (this->stopping) {
+                return;
+            }
+            seen = this->generation;
+            // only the first n_helpers workers take part in the current job
+            if (index >= this->n_helpers) {
+                continue;
+            }
+        }
+
+        this->take_tasks();
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (--this->running == 0) {
+                this->finished.notify_all();
+            }
+        }
+    }
+}
+
+void qs::ThreadPool::run(int n_tasks, int n_threads, const std::function<void(int)>& task) {
+    int helpers = std::min(n_threads, n_tasks) - 1;
+
+    if (in_task || helpers <= 0) {
+        for (int i = 0; i < n_tasks; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> job_lock(this->job_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        // start missing workers, they stay alive for the next jobs
+        while (this->workers.size() < helpers) {
+            this->workers.push_back(std::thread(&qs::ThreadPool::work, this, (int)this->workers.size(), this->generation));
+        }
+        this->job = &task;
+        this->n_tasks = n_tasks;
+        this->n_helpers = helpers;
+        this->next_task = 0;
+        this->running = helpers;
+        ++this->generation;
+    }
+    this->wake.notify_all();
+
+    this->take_tasks();
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->finished.wait(lock, [&]() { return this->running == 0; });
+    this->job = nullptr;
+}
+
+int qs::_hardware_threads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::size_t qs::_chunk_size(std::size_t n, std::size_t min_chunk) {
+    std::size_t max_chunks = 1024;
+    std::size_t n_chunks = std::max((std::size_t)1, std::min(max_chunks, n / std::max((std::size_t)1, min_chunk)));
+    return std::max((std::size_t)1, (n + n_chunks - 1) / n_chunks);
+}
+
+void qs::_parallel_for(std::size_t n, int n_threads, const std::function<void(std::size_t, std::size_t)>& fn, std::size_t min_chunk) {
+    if (n == 0) {
+        return;
+    }
+
+    std::size_t chunk = qs::_chunk_size(n, min_chunk);
+    std::size_t n_chunks = (n + chunk - 1) / chunk;
+
+    qs::ThreadPool::instance().run(n_chunks, n_threads, [&](int i) {
+        std::size_t begin = i * chunk;
+        fn(begin, std::min(n, begin + chunk));
+    });
+}
+
+double qs::_parallel_sum(std::size_t n, int n_threads, const std::function<double(std::size_t, std::size_t)>& fn, std::size_t min_chunk) {
+    if (n == 0) {
+        return 0.0;
+    }
+
+    std::size_t chunk = qs::_chunk_size(n, min_chunk);
+    std::size_t n_chunks = (n + chunk - 1) / chunk;
+
+    std::vector<double> partial(n_chunks, 0.0);
+    qs::ThreadPool::instance().run(n_chunks, n_threads, [&](int i) {
+        std::size_t begin = i * chunk;
+        partial[i] = fn(begin, std::min(n, begin + chunk));
+    });
+
+    double sum = 0.0;
+    for (double p : partial) {
+        sum += p;
+    }
+    return sum;
+}
@@ -0,0 +1,62 @@
+#ifndef __PARALLEL_HPP__
+#define __PARALLEL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qs {
+
+    // pool of worker threads which are started once and reused by all parallel loops
+    class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        // only one job runs in the pool at a time
+        std::mutex job_mutex;
+
+        // current job split into tasks 0, ..., n_tasks - 1
+        const std::function<void(int)>* job;
+        int n_tasks;
+        int n_helpers;
+        std::atomic<int> next_task;
+        int running;
+        long generation;
+        bool stopping;
+
+        void work(int index, long seen);
+        void take_tasks();
+
+    public:
+        ThreadPool();
+        ~ThreadPool();
+
+        // global pool shared by the library
+        static ThreadPool& instance();
+
+        // run task(i) for every i < n_tasks on up to n_threads threads including the calling one and wait for them
+        // calls from inside a task run serially to avoid waiting on the pool itself
+        void run(int n_tasks, int n_threads, const std::function<void(int)>& task);
+    };
+
+    // number of threads used when no thread count is given
+    int _hardware_threads();
+
+    // size of chunks of range [0, n) with at least min_chunk items, chunk i starts at i * _chunk_size(n, min_chunk)
+    // the chunks depend only on n and min_chunk, not on the number of threads
+    std::size_t _chunk_size(std::size_t n, std::size_t min_chunk);
+
+    // split range [0, n) into chunks of at least min_chunk items and call fn(begin, end) on them in parallel
+    void _parallel_for(std::size_t n, int n_threads, const std::function<void(std::size_t, std::size_t)>& fn, std::size_t min_chunk = 1 << 14);
+
+    // sum fn(begin, end) over chunks of range [0, n) computed in parallel, the partial sums are added in a fixed order
+    double _parallel_sum(std::size_t n, int n_threads, const std::function<double(std::size_t, std::size_t)>& fn, std::size_t min_chunk = 1 << 14);
+};
+
+#endif